@@ -0,0 +1,59 @@
+/**
+ * @file baud.c
+ * @brief baud rate switch with the Propeller, builds on the host as well
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <string.h>
+#include "baud.h"
+
+// alternating bits and runs exercise every edge spacing
+const uint8_t baudProbe[8] = { 0x55, 0xAA, 0x0F, 0xF0, 0x33, 0xCC, 0x00, 0xFF };
+const uint8_t baudConfirm[2] = { 0xC3, 0x3C };
+
+
+uint32_t baudActual(int rate)
+{
+    uint32_t div;
+
+    // the divider has 4 fraction bits and truncates
+    div = ((uint64_t)BAUD_CLOCK << 4) / rate;
+    return ((uint64_t)BAUD_CLOCK << 4) / div;
+}
+
+bool baudValid(int rate)
+{
+    int64_t miss;
+
+    if ((rate < BAUD_MIN) || (rate > BAUD_MAX))
+        return false;
+
+    miss = (int64_t)baudActual(rate) - rate;
+    if (miss < 0)
+        miss = -miss;
+    return miss * 1000000 / rate <= BAUD_TOLERANCE;
+}
+
+int baudSwitch(const baud_link *link, int from, int to)
+{
+    uint8_t buf[sizeof(baudProbe)];
+
+    // drop old input before the switch so an early probe is kept
+    link->flush();
+    link->setRate(to);
+
+    if ((link->read(buf, sizeof(baudProbe), BAUD_PROBE_MS) == sizeof(baudProbe)) &&
+        (memcmp(buf, baudProbe, sizeof(baudProbe)) == 0))
+    {
+        link->write(baudProbe, sizeof(baudProbe));
+        if ((link->read(buf, sizeof(baudConfirm), BAUD_CONFIRM_MS) == sizeof(baudConfirm)) &&
+            (memcmp(buf, baudConfirm, sizeof(baudConfirm)) == 0))
+            return 0;
+    }
+
+    link->setRate(from);
+    link->flush();
+    return -1;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file baud.h
+ * @brief baud rate switch with the Propeller, builds on the host as well
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef BAUD_H
+#define BAUD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BAUD_MIN            9600
+#define BAUD_MAX            3000000
+#define BAUD_CLOCK          80000000    // uart source clock, APB
+#define BAUD_TOLERANCE      10000       // ppm the divider may miss a rate by
+#define BAUD_SETTLE_MS      5           // Propeller waits this long after the ack
+#define BAUD_PROBE_MS       500         // time the Propeller has to send the probe
+#define BAUD_CONFIRM_MS     500         // time it has to confirm the echo
+
+/*
+ * After the ack at the old rate both sides switch. The Propeller waits
+ * BAUD_SETTLE_MS, sends baudProbe and expects it echoed. With the echo it
+ * sends baudConfirm and stays, without it falls back to the old rate.
+ * The ESP goes back to the old rate unless the probe and the confirm both
+ * arrive. A lost probe or echo leaves both sides at the old rate. A lost
+ * confirm leaves only the Propeller at the new rate, so a Propeller that
+ * gets no answer to its first command after the switch falls back too.
+ */
+extern const uint8_t baudProbe[8];
+extern const uint8_t baudConfirm[2];
+
+// the uart the switch is run on
+typedef struct
+{
+    void (*setRate)(int rate);
+    int (*read)(uint8_t *buf, int len, int ms);     // bytes read within ms
+    void (*write)(const uint8_t *buf, int len);     // returns once sent
+    void (*flush)(void);                            // drop unread input
+} baud_link;
+
+/**
+ * @brief Rate the uart divider produces for a requested rate
+ * @param rate requested
+ * @return actual rate
+ */
+uint32_t baudActual(int rate);
+
+/**
+ * @brief Check that a rate is in range and the divider can produce it
+ * @param rate requested
+ * @return true if usable
+ */
+bool baudValid(int rate);
+
+/**
+ * @brief Switch rates once the ack has gone out at the old rate
+ * @param link uart
+ * @param from current rate, restored on failure
+ * @param to new rate
+ * @return 0 or -1 if the probe or confirm did not arrive and the link is back at from
+ */
+int baudSwitch(const baud_link *link, int from, int to);
+
+#endif
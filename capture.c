@@ -0,0 +1,233 @@
+/**
+ * @file capture.c
+ * @brief uart capture to the storage partition
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "config.h"
+#include "capture.h"
+
+static const char *TAG = "capture";
+
+typedef struct
+{
+    int buffer;
+    int len;
+} capture_job;
+
+// the uart tasks fill one buffer while the writer task puts the other on flash
+static char capBuffer[2][CAPTURE_BUFFER];
+static int capActive;
+static int capFill;
+static bool capBusy;
+static SemaphoreHandle_t capLock;
+static QueueHandle_t capJobs;
+
+// files belong to the writer task, start only asks it to begin a new set
+static volatile bool capRunning;
+static volatile bool capRestart;
+static FILE *capFile;
+static int capIndex;
+static int capSize;
+static int64_t capStart;
+static uint32_t capWritten;
+static uint32_t capDropped;     // under the lock, both sides drop data
+
+
+/**
+ * @brief hand the active buffer to the writer, called with the lock held
+ * @return false if the writer still has the other buffer
+ */
+static bool captureSwap(void)
+{
+    capture_job job;
+
+    if (capBusy)
+        return false;
+
+    job.buffer = capActive;
+    job.len = capFill;
+    capBusy = true;
+    capActive ^= 1;
+    capFill = 0;
+    xQueueSend(capJobs, &job, 0);
+
+    return true;
+}
+
+static void captureOpen(void)
+{
+    char name[32];
+
+    sprintf(name, "/spiffs/capture%d.bin", capIndex);
+    capFile = fopen(name, "w");
+    capSize = 0;
+    if (capFile == NULL)
+        ESP_LOGE(TAG, "Unable to open %s", name);
+    else
+        ESP_LOGI(TAG, "Capturing to %s", name);
+}
+
+static void captureTask(void *parms)
+{
+    capture_job job;
+    uint32_t dropped;
+    int n;
+
+    while (true)
+    {
+        // a quiet uart still gets its data on flash within CAPTURE_FLUSH_MS
+        n = xQueueReceive(capJobs, &job, CAPTURE_FLUSH_MS / portTICK_PERIOD_MS);
+
+        if (capRestart)
+        {
+            capRestart = false;
+            if (capFile != NULL)
+                fclose(capFile);
+            capIndex = 0;
+            captureOpen();
+        }
+
+        if (n != pdTRUE)
+        {
+            xSemaphoreTake(capLock, portMAX_DELAY);
+            if (capFill > 0)
+                captureSwap();
+            else if (!capRunning && (capFile != NULL))
+            {
+                fclose(capFile);
+                capFile = NULL;
+            }
+            xSemaphoreGive(capLock);
+            continue;
+        }
+
+        dropped = 0;
+        if (capFile != NULL)
+        {
+            n = fwrite(capBuffer[job.buffer], 1, job.len, capFile);
+            fflush(capFile);
+            if (n != job.len)
+            {
+                ESP_LOGE(TAG, "Capture write failed");
+                dropped = job.len - n;
+            }
+            capWritten += n;
+            capSize += n;
+
+            if (capSize >= flashConfig.capture_size)
+            {
+                fclose(capFile);
+                capIndex = (capIndex + 1) % CAPTURE_FILES;
+                captureOpen();
+            }
+        }
+        else
+        {
+            dropped = job.len;
+        }
+
+        xSemaphoreTake(capLock, portMAX_DELAY);
+        capDropped += dropped;
+        capBusy = false;
+        xSemaphoreGive(capLock);
+    }
+}
+
+void captureInit(void)
+{
+    capLock = xSemaphoreCreateMutex();
+    capJobs = xQueueCreate(1, sizeof(capture_job));
+    xTaskCreate(captureTask, "capture", 3072, NULL, 4, NULL);
+
+    if (flashConfig.capture)
+        captureStart();
+}
+
+void captureStart(void)
+{
+    if ((capLock == NULL) || capRunning)
+        return;
+
+    capStart = esp_timer_get_time();
+    capWritten = 0;
+    xSemaphoreTake(capLock, portMAX_DELAY);
+    capDropped = 0;
+    xSemaphoreGive(capLock);
+    capRestart = true;
+    capRunning = true;
+}
+
+void captureStop(void)
+{
+    capRunning = false;
+}
+
+void captureWrite(int dir, const char *data, int len)
+{
+    char *p;
+    uint32_t ms;
+    int n;
+
+    if (!capRunning || (len <= 0))
+        return;
+
+    ms = esp_timer_get_time() / 1000;
+
+    // the writer only takes the lock to swap, never across a flash write
+    xSemaphoreTake(capLock, portMAX_DELAY);
+    while (len > 0)
+    {
+        n = len;
+        if (n > CAPTURE_BUFFER - CAPTURE_HEADER)
+            n = CAPTURE_BUFFER - CAPTURE_HEADER;
+        if ((capFill + CAPTURE_HEADER + n > CAPTURE_BUFFER) && !captureSwap())
+        {
+            capDropped += len;
+            break;
+        }
+
+        p = &capBuffer[capActive][capFill];
+        p[0] = CAPTURE_MAGIC;
+        p[1] = dir;
+        p[2] = ms;
+        p[3] = ms >> 8;
+        p[4] = ms >> 16;
+        p[5] = ms >> 24;
+        p[6] = n;
+        p[7] = n >> 8;
+        memcpy(&p[CAPTURE_HEADER], data, n);
+        capFill += CAPTURE_HEADER + n;
+        data += n;
+        len -= n;
+    }
+    xSemaphoreGive(capLock);
+}
+
+void captureStats(capture_stats *stats)
+{
+    int64_t t;
+
+    stats->written = capWritten;
+    stats->dropped = 0;
+    if (capLock != NULL)
+    {
+        xSemaphoreTake(capLock, portMAX_DELAY);
+        stats->dropped = capDropped;
+        xSemaphoreGive(capLock);
+    }
+    stats->file = capIndex;
+    t = (esp_timer_get_time() - capStart) / 1000000;
+    stats->rate = (capRunning && (t > 0)) ? capWritten / t : 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file capture.h
+ * @brief uart capture to the storage partition
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+/*
+ * Capture files are /capture0.bin to /capture3.bin, reused in turn once
+ * one reaches flashConfig.capture_size. Each holds records of
+ * <0xCA><direction><milliseconds, 4 bytes><length, 2 bytes><data>
+ * with little endian fields. Direction is CAPTURE_RX for data from the
+ * Propeller and CAPTURE_TX for data to it.
+ */
+#define CAPTURE_FILES 4
+#define CAPTURE_BUFFER 4096
+#define CAPTURE_FLUSH_MS 1000
+#define CAPTURE_MAGIC 0xCA
+#define CAPTURE_HEADER 8
+
+#define CAPTURE_RX 0
+#define CAPTURE_TX 1
+
+typedef struct
+{
+    uint32_t written;       // bytes of data on flash
+    uint32_t dropped;       // bytes lost because flash fell behind
+    uint32_t rate;          // average bytes per second since the start
+    int file;               // file being written
+} capture_stats;
+
+/**
+ * @brief Start the writer task, and capturing if flashConfig.capture is set
+ */
+void captureInit(void);
+
+/**
+ * @brief Start capturing into a fresh set of files
+ */
+void captureStart(void);
+
+/**
+ * @brief Stop capturing, buffered data is still written
+ */
+void captureStop(void);
+
+/**
+ * @brief Record uart traffic, never waits for flash
+ * @param dir CAPTURE_RX or CAPTURE_TX
+ * @param data traffic
+ * @param len length of traffic
+ */
+void captureWrite(int dir, const char *data, int len);
+
+/**
+ * @brief Capture counters
+ * @param stats filled in
+ */
+void captureStats(capture_stats *stats);
+
+#endif
@@ -6,9 +6,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
 #include "esp_wifi.h"
 #include "esp_log.h"
 #include "driver/uart.h"
@@ -19,14 +23,52 @@
 #include "lwip/netdb.h"
 #include "lwip/dns.h"
 
+#include "esp_timer.h"
+
 #include "cmds.h"
+#include "config.h"
 #include "parser.h"
+#include "httpd.h"
 #include "status.h"
+#include "dnscache.h"
+
+#define CMD_HASH_SIZE 64
+#define CMD_HASH_MULT 19
 
 static const char* TAG = "cmds";
 
-static int Socket = -1;
-static char SRBuff[1024];
+enum
+{
+    CONN_FREE,
+    CONN_CONNECTING,        // owned by the connect task
+    CONN_OPEN,
+    CONN_FAILED             // freed once the failure is reported
+};
+
+/* an upstream connection, the handle is its index in the table */
+struct cmd_connection
+{
+    int state;
+    int sock;
+    char host[64];
+    int port;
+    int result;             // ERROR_NONE or why the connect failed
+    bool reported;          // completion sent as an event or a POLL result
+    bool cancel;            // closed while connecting
+    char *rxBuffer;         // from the fixed pool, one per slot
+    char *txBuffer;
+    cmd_conn_stats stats;
+};
+
+static cmd_connection Connections[CMD_CONNECTION];
+static char RxPool[CMD_CONNECTION][CMD_RX_BUFFER];
+static char TxPool[CMD_CONNECTION][CMD_TX_BUFFER];
+
+// covers claiming and freeing slots, commands on one handle are kept in order by their lane
+static SemaphoreHandle_t connLock;
+
+// connections waiting for lookup and connect
+static QueueHandle_t connectQueue;
 
 extern esp_err_t register_uri();
 extern esp_err_t handleReply(int , char *, int , int);
@@ -34,9 +76,436 @@ extern esp_err_t getVar(int, char *, char *);
 extern esp_err_t polling(int);
 
 
-void cmd_init(void)
+#define CMD_ENTRY(n, t, h, a, f) { #n, t, h, a, f, 0, 0 },
+static cmd_entry Commands[] = {
+    CMD_TABLE(CMD_ENTRY)
+};
+#undef CMD_ENTRY
+
+#define CMD_COUNT (sizeof(Commands) / sizeof(Commands[0]))
+
+static cmd_entry *Hash[CMD_HASH_SIZE];
+
+typedef struct
+{
+    int tag;
+    char parms[CMD_PARMS];
+} cmd_job;
+
+typedef struct
+{
+    QueueHandle_t jobs;
+    TaskHandle_t task;
+    atomic_int pending;
+    int tag;
+} cmd_lane;
+
+static cmd_lane Lanes[CONFIG_CMD_LANES];
+static TaskHandle_t parserTask;
+static int parserTag;
+
+
+static int cmdHash(const char *name)
+{
+    uint32_t h = 0;
+
+    while (*name != 0)
+        h = h * CMD_HASH_MULT + (uint8_t)*name++;
+
+    return h & (CMD_HASH_SIZE - 1);
+}
+
+static int cmdArgs(char *s)
+{
+    int n;
+
+    if (*s == 0)
+        return 0;
+
+    for (n = 1; (s = strchr(s, ',')) != NULL; s++)
+        n++;
+
+    return n;
+}
+
+static void cmdWorker(void *pvParameters)
+{
+    cmd_lane *lane = pvParameters;
+    cmd_job job;
+
+    while (true)
+    {
+        xQueueReceive(lane->jobs, &job, portMAX_DELAY);
+        lane->tag = job.tag;
+        cmdDispatch(job.parms);
+        lane->tag = 0;
+        atomic_fetch_sub(&lane->pending, 1);
+        xTaskNotifyGive(parserTask);
+    }
+}
+
+static int cmdLane(cmd_entry *cmd, char *parms)
 {
+    if ((CONFIG_CMD_LANES < 2) || (cmd == NULL) || ((cmd->flags & CMD_BYHANDLE) == 0))
+        return 0;
 
+    return 1 + (unsigned)atoi(&parms[1]) % (CONFIG_CMD_LANES - 1);
+}
+
+/**
+ * @brief check for a command that must wait for every lane
+ * @param cmd command or NULL
+ * @param parms token and arguments
+ * @return true for BAUD and a SET of the baud rate
+ */
+static bool cmdBarrier(cmd_entry *cmd, char *parms)
+{
+    if (cmd == NULL)
+        return false;
+
+    if ((cmd->flags & CMD_BARRIER) != 0)
+        return true;
+
+    return (cmd->token == TKN_SET) && (strncmp(&parms[1], "baud-rate,", 10) == 0);
+}
+
+/**
+ * @brief wait for queued commands to finish
+ * @param lane to wait for or -1 for all lanes
+ */
+static void cmdWait(int lane)
+{
+    for (int i = 0; i < CONFIG_CMD_LANES; i++)
+    {
+        if ((lane >= 0) && (lane != i))
+            continue;
+
+        while (atomic_load(&Lanes[i].pending) != 0)
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief claim a free connection slot
+ * @return connection or NULL if all are in use
+ */
+static cmd_connection *connAlloc(void)
+{
+    cmd_connection *conn = NULL;
+
+    xSemaphoreTake(connLock, portMAX_DELAY);
+    for (int i = 0; i < CMD_CONNECTION; i++)
+    {
+        if (Connections[i].state == CONN_FREE)
+        {
+            conn = &Connections[i];
+            conn->state = CONN_CONNECTING;
+            conn->sock = -1;
+            conn->result = ERROR_NONE;
+            conn->reported = false;
+            conn->cancel = false;
+            memset(&conn->stats, 0, sizeof(conn->stats));
+            conn->stats.opened = esp_timer_get_time();
+            break;
+        }
+    }
+    xSemaphoreGive(connLock);
+
+    return conn;
+}
+
+static void connFree(cmd_connection *conn)
+{
+    xSemaphoreTake(connLock, portMAX_DELAY);
+    if (conn->sock >= 0)
+        close(conn->sock);
+    conn->sock = -1;
+    conn->state = CONN_FREE;
+    xSemaphoreGive(connLock);
+}
+
+/**
+ * @brief send a connect completion, a failed slot is freed once reported
+ * @param conn connection that finished connecting
+ */
+static void connReport(cmd_connection *conn)
+{
+    int handle = conn - Connections;
+    int result = conn->result;
+
+    if (conn->state == CONN_FAILED)
+        connFree(conn);
+
+    sendResponseP('C', handle, result);
+}
+
+/**
+ * @brief look up the connection named by a handle argument
+ * @param s handle text
+ * @return connection or NULL if the handle is not open
+ */
+static cmd_connection *connFind(char *s)
+{
+    int handle;
+
+    handle = atoi(s);
+    if ((handle < 0) || (handle >= CMD_CONNECTION) || (Connections[handle].state != CONN_OPEN))
+        return NULL;
+
+    return &Connections[handle];
+}
+
+/**
+ * @brief look up and connect, on the connect task
+ * @param conn connection being opened
+ * @return ERROR_NONE or the reason it failed
+ */
+static int connOpen(cmd_connection *conn)
+{
+    struct sockaddr_in sockaddr;
+    struct timeval timeout;
+    fd_set writefds;
+    socklen_t len;
+    int err, flags;
+
+    sockaddr.sin_family = AF_INET;
+    sockaddr.sin_port = htons(conn->port);
+    if (inet_aton(conn->host, &sockaddr.sin_addr) == 0)
+    {
+        if (dnsCacheLookup(conn->host, &sockaddr.sin_addr.s_addr) != 0)
+            return ERROR_LOOKUP_FAILED;
+    }
+
+    conn->sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (conn->sock < 0)
+        return ERROR_CONNECT_FAILED;
+
+    // connect without blocking so an unreachable host times out on our terms
+    flags = fcntl(conn->sock, F_GETFL, 0);
+    fcntl(conn->sock, F_SETFL, flags | O_NONBLOCK);
+    if ((connect(conn->sock, (const struct sockaddr*)&sockaddr, sizeof(sockaddr)) != 0) && (errno != EINPROGRESS))
+        return ERROR_CONNECT_FAILED;
+
+    FD_ZERO(&writefds);
+    FD_SET(conn->sock, &writefds);
+    timeout.tv_sec = CMD_CONNECT_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (CMD_CONNECT_TIMEOUT_MS % 1000) * 1000;
+    if (select(conn->sock + 1, NULL, &writefds, NULL, &timeout) <= 0)
+        return ERROR_CONNECT_FAILED;
+
+    len = sizeof(err);
+    if ((getsockopt(conn->sock, SOL_SOCKET, SO_ERROR, &err, &len) != 0) || (err != 0))
+        return ERROR_CONNECT_FAILED;
+
+    // SEND and RECV expect a blocking socket
+    fcntl(conn->sock, F_SETFL, flags);
+    return ERROR_NONE;
+}
+
+static void connTask(void *pvParameters)
+{
+    cmd_connection *conn;
+    bool event;
+
+    while (true)
+    {
+        xQueueReceive(connectQueue, &conn, portMAX_DELAY);
+        conn->result = connOpen(conn);
+
+        xSemaphoreTake(connLock, portMAX_DELAY);
+        event = !conn->cancel;
+        if (conn->cancel)
+        {
+            // CLOSE already answered, nobody is waiting for this one
+            if (conn->sock >= 0)
+                close(conn->sock);
+            conn->sock = -1;
+            conn->state = CONN_FREE;
+        }
+        else if (conn->result == ERROR_NONE)
+            conn->state = CONN_OPEN;
+        else
+            conn->state = CONN_FAILED;
+
+        if (event && (flashConfig.events != 0))
+            conn->reported = true;
+        xSemaphoreGive(connLock);
+
+        if (event && (flashConfig.events != 0))
+            connReport(conn);
+    }
+}
+
+void cmdInit(void)
+{
+    int h;
+
+    parserTask = xTaskGetCurrentTaskHandle();
+
+    connLock = xSemaphoreCreateMutex();
+    dnsCacheInit(NULL);
+    connectQueue = xQueueCreate(CMD_CONNECTION, sizeof(cmd_connection*));
+    xTaskCreate(connTask, "cmdconnect", 4096, NULL, 5, NULL);
+    for (int i = 0; i < CMD_CONNECTION; i++)
+    {
+        Connections[i].state = CONN_FREE;
+        Connections[i].sock = -1;
+        Connections[i].rxBuffer = RxPool[i];
+        Connections[i].txBuffer = TxPool[i];
+    }
+
+    for (int i = 0; i < CONFIG_CMD_LANES; i++)
+    {
+        Lanes[i].jobs = xQueueCreate(4, sizeof(cmd_job));
+        atomic_store(&Lanes[i].pending, 0);
+        Lanes[i].tag = 0;
+        xTaskCreate(cmdWorker, "cmdlane", 4096, &Lanes[i], 5, &Lanes[i].task);
+    }
+
+    memset(Hash, 0, sizeof(Hash));
+
+    for (int i = 0; i < CMD_COUNT; i++)
+    {
+        // lookups trust both maps, a table edit that breaks either stops the boot
+        if (Commands[i].token != TKN_JOIN - i)
+        {
+            ESP_LOGE(TAG, "Command %s out of token order", Commands[i].name);
+            abort();
+        }
+
+        h = cmdHash(Commands[i].name);
+        if (Hash[h] != NULL)
+        {
+            ESP_LOGE(TAG, "Command %s collides with %s", Commands[i].name, Hash[h]->name);
+            abort();
+        }
+        Hash[h] = &Commands[i];
+    }
+}
+
+cmd_entry *cmdFindName(const char *name)
+{
+    cmd_entry *cmd;
+
+    cmd = Hash[cmdHash(name)];
+    if ((cmd == NULL) || (strcmp(cmd->name, name) != 0))
+        return NULL;
+
+    return cmd;
+}
+
+cmd_entry *cmdFindToken(uint8_t token)
+{
+    uint8_t i;
+
+    i = TKN_JOIN - token;
+    if (i >= CMD_COUNT)
+        return NULL;
+
+    return &Commands[i];
+}
+
+void cmdDispatch(char *parms)
+{
+    cmd_entry *cmd;
+    int64_t start;
+
+    if (parms[0] == 0)
+    {
+        doNothing(parms);
+        return;
+    }
+
+    cmd = cmdFindToken(parms[0]);
+    if (cmd == NULL)
+    {
+        sendResponse('E', ERROR_INVALID_REQUEST);
+        return;
+    }
+
+    if (cmd->handler == NULL)
+    {
+        sendResponse('E', ERROR_UNIMPLEMENTED);
+        return;
+    }
+
+    if (cmdArgs(&parms[1]) < cmd->args)
+    {
+        sendResponse('E', ERROR_WRONG_ARGUMENT_COUNT);
+        return;
+    }
+
+    start = esp_timer_get_time();
+    cmd->handler(parms);
+    __atomic_fetch_add(&cmd->time, esp_timer_get_time() - start, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cmd->count, 1, __ATOMIC_RELAXED);
+}
+
+void cmdSubmit(int tag, char *parms)
+{
+    cmd_entry *cmd;
+    cmd_job job;
+    int lane;
+
+    if (tag == 0)
+    {
+        // untagged commands keep strict request/response order
+        cmdWait(-1);
+        cmdDispatch(parms);
+        return;
+    }
+
+    cmd = cmdFindToken(parms[0]);
+    lane = cmdBarrier(cmd, parms) ? -1 : cmdLane(cmd, parms);
+
+    if ((cmd == NULL) || (lane < 0) || ((cmd->flags & CMD_INLINE) != 0) || (strlen(parms) >= CMD_PARMS))
+    {
+        cmdWait(lane);
+        parserTag = tag;
+        cmdDispatch(parms);
+        parserTag = 0;
+        return;
+    }
+
+    job.tag = tag;
+    strcpy(job.parms, parms);
+    atomic_fetch_add(&Lanes[lane].pending, 1);
+    xQueueSend(Lanes[lane].jobs, &job, portMAX_DELAY);
+}
+
+void cmdWaitAll(void)
+{
+    cmdWait(-1);
+}
+
+int cmdGetTag(void)
+{
+    TaskHandle_t task;
+
+    task = xTaskGetCurrentTaskHandle();
+    if (task == parserTask)
+        return parserTag;
+
+    for (int i = 0; i < CONFIG_CMD_LANES; i++)
+        if (task == Lanes[i].task)
+            return Lanes[i].tag;
+
+    return 0;
+}
+
+cmd_entry *cmdTable(int *count)
+{
+    *count = CMD_COUNT;
+    return Commands;
+}
+
+int cmdConnectionStats(int handle, cmd_conn_stats *stats)
+{
+    if ((handle < 0) || (handle >= CMD_CONNECTION) || (Connections[handle].state != CONN_OPEN))
+        return -1;
+
+    *stats = Connections[handle].stats;
+    return 0;
 }
 
 void doNothing(char* parms)
@@ -68,11 +537,54 @@ void doJoin(char* parms)
     sendResponse('E', ERROR_INVALID_ARGUMENT);
 }
 
+/**
+ * @brief read and drop the rest of a SEND payload so the parser stays in step
+ * @param len bytes still to come
+ */
+static void sendDiscard(int len)
+{
+    char discard[64];
+    int n;
+
+    while (len > 0)
+    {
+        n = receiveBytes(discard, len < sizeof(discard) ? len : sizeof(discard));
+        if (n <= 0)
+            return;
+        len -= n;
+    }
+}
+
+/**
+ * @brief write all of a buffer, the socket may take it in pieces
+ * @param sock socket
+ * @param data to write
+ * @param len length of data
+ * @return 0 or -1 if the connection failed
+ */
+static int sendAll(int sock, char *data, int len)
+{
+    int n;
+
+    while (len > 0)
+    {
+        n = write(sock, data, len);
+        if (n < 0)
+            return -1;
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/* handle, count \r <data>, the data is written to the socket as it arrives */
 void doSend(char* parms)
 {
+    cmd_connection *conn;
     char* p, * s;
     int len;
-    int i;
+    int i, n, idle;
 
     s = &parms[1];
     p = strchr(s, ',');
@@ -84,42 +596,60 @@ void doSend(char* parms)
     }
     p++;
     len = atoi(p);
-    if ((len <= 0) || len > 1024)
+    if (len <= 0)
     {
         sendResponse('E', ERROR_INVALID_SIZE);
         return;
     }
-    if (Socket == -1)
+    conn = connFind(s);
+    if (conn == NULL)
     {
+        sendDiscard(len);
         sendResponse('E', ERROR_INVALID_STATE);
         return;
     }
 
+    // the tx buffer bounds what is in flight between the uart and the socket
     i = 0;
+    idle = 0;
     while (i < len)
     {
-        i += receiveBytes(&SRBuff[i], 1024-i);
-    }
-
-    if (Socket == -1)
-    {
-        sendResponse('E', ERROR_INVALID_STATE);
-        return;
-    }
-
-    if (write(Socket, SRBuff, i) < 0)
-    {
-        sendResponse('E', ERROR_SEND_FAILED);
-        close(Socket);
-        Socket = -1;
-        return;
+        n = receiveBytes(conn->txBuffer, len - i < CMD_TX_BUFFER ? len - i : CMD_TX_BUFFER);
+        if (n < 0)
+        {
+            sendResponse('E', ERROR_INVALID_SIZE);
+            return;
+        }
+        if (n == 0)
+        {
+            // the Propeller stopped short of the count it gave
+            if (++idle < CMD_SEND_IDLE)
+                continue;
+            sendDiscard(len - i);
+            sendResponse('E', ERROR_INVALID_SIZE);
+            return;
+        }
+        idle = 0;
+        if (sendAll(conn->sock, conn->txBuffer, n) != 0)
+        {
+            sendDiscard(len - i - n);
+            sendResponse('E', ERROR_SEND_FAILED);
+            conn->stats.errors++;
+            connFree(conn);
+            return;
+        }
+        i += n;
+        conn->stats.txBytes += n;
     }
 
+    conn->stats.sends++;
     sendResponse('S', ERROR_NONE);
 }
 
+/* handle, max count, answered with up to CMD_RX_BUFFER bytes */
 void doRecv(char* parms)
 {
+    cmd_connection *conn;
     char* p, * s;
     int len;
     struct timeval receiving_timeout;
@@ -133,7 +663,15 @@ void doRecv(char* parms)
     }
     p++;
     len = atoi(p);
-    if (Socket == -1)
+    if (len <= 0)
+    {
+        sendResponse('E', ERROR_INVALID_SIZE);
+        return;
+    }
+    if (len > CMD_RX_BUFFER)
+        len = CMD_RX_BUFFER;
+    conn = connFind(s);
+    if (conn == NULL)
     {
         sendResponse('E', ERROR_INVALID_STATE);
         return;
@@ -141,30 +679,27 @@ void doRecv(char* parms)
 
     receiving_timeout.tv_sec = 5;
     receiving_timeout.tv_usec = 0;
-    setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &receiving_timeout, sizeof(receiving_timeout));
+    setsockopt(conn->sock, SOL_SOCKET, SO_RCVTIMEO, &receiving_timeout, sizeof(receiving_timeout));
 
-    len = read(Socket, SRBuff, len);
-
-    sendResponse('S', len);
+    len = read(conn->sock, conn->rxBuffer, len);
+    if (len < 0)
+    {
+        conn->stats.errors++;
+        len = 0;
+    }
 
-    sendBytes(SRBuff, len);
+    conn->stats.recvs++;
+    conn->stats.rxBytes += len;
+    sendResponseD('S', len, conn->rxBuffer, len);
 }
 
+/* host, port, answered with the handle before the connection is up */
 void doConnect(char* parms)
 {
+    cmd_connection *conn;
     char* p, * s;
-    char* url;
     int port;
-    struct addrinfo* res;
-    struct sockaddr_in sockaddr;
-    uint32_t addr; 
-    int err;
 
-    const struct addrinfo hints = {
-        .ai_family = AF_INET,
-        .ai_socktype = SOCK_STREAM,
-    };
-    
     s = &parms[1];
     p = strchr(s, ',');
     if (p == NULL)
@@ -174,61 +709,59 @@ void doConnect(char* parms)
     }
     *p = 0;
     p++;
-    url = s;
-    s = p;
-    port = atoi(s);
-    if (port == 0)
+    port = atoi(p);
+    if ((port <= 0) || (port > 65535) || (strlen(s) >= sizeof(conn->host)))
     {
         sendResponse('E', ERROR_INVALID_ARGUMENT);
         return;
     }
 
-    if (url[0] <= '9')
-    {
-        addr = esp_ip4addr_aton(url);
-        sockaddr.sin_family = AF_INET;
-        sockaddr.sin_addr.s_addr = htonl(addr);
-        sockaddr.sin_port = htons(port);
-    }
-    else
-    {
-        err = getaddrinfo(url, s, &hints, &res);
-        if ((err != 0) || (res == NULL))
-        {
-            ESP_LOGE(TAG, "DNS lookup failed err=%d", err);
-            return;
-        }
-        sockaddr.sin_family = ((struct sockaddr_in*)res->ai_addr)->sin_family;
-        sockaddr.sin_addr = ((struct sockaddr_in*)res->ai_addr)->sin_addr;
-        sockaddr.sin_port = htons(port);
-        freeaddrinfo(res);
-    }
-
-    Socket = socket(sockaddr.sin_family, SOCK_STREAM, 0);
-    if (connect(Socket, (const struct sockaddr*)&sockaddr, sizeof(sockaddr)) != 0)
+    conn = connAlloc();
+    if (conn == NULL)
     {
-        sendResponse('E', ERROR_CONNECT_FAILED);
-        close(Socket);
-        Socket = -1;
+        sendResponse('E', ERROR_NO_FREE_CONNECTION);
         return;
     }
 
-    sendResponse('S', Socket);
+    strcpy(conn->host, s);
+    conn->port = port;
+    xQueueSend(connectQueue, &conn, portMAX_DELAY);
+
+    sendResponse('S', conn - Connections);
 }
 
+/* handle */
 void doClose(char* parms)
 {
-    int i;
+    cmd_connection *conn;
+    int handle;
 
-    i = atoi(parms);
+    handle = atoi(&parms[1]);
+    if ((handle < 0) || (handle >= CMD_CONNECTION))
+    {
+        sendResponse('E', ERROR_INVALID_STATE);
+        return;
+    }
+    conn = &Connections[handle];
 
-    if (Socket == -1)
+    xSemaphoreTake(connLock, portMAX_DELAY);
+    if (conn->state == CONN_CONNECTING)
+    {
+        // the connect task frees it when the attempt ends
+        conn->cancel = true;
+        xSemaphoreGive(connLock);
+        sendResponse('S', ERROR_NONE);
+        return;
+    }
+    xSemaphoreGive(connLock);
+
+    if (conn->state == CONN_FREE)
     {
         sendResponse('E', ERROR_INVALID_STATE);
         return;
     }
-    close(Socket);
-    Socket = -1;
+
+    connFree(conn);
     sendResponse('S', ERROR_NONE);
 }
 
@@ -297,16 +830,21 @@ void doReply(char *parms)
         count = atoi(s);
         tcount = count;
         ESP_LOGI(TAG, "CallingReply with:%d", count);
-        handleReply(handle, code, tcount, count);
-        sendResponse('S', ERROR_NONE);
-        return;
+    }
+    else
+    {
+        *p = 0;
+        tcount = atoi(s);
+        s = p + 1;
+        count = atoi(s);
     }
 
-    *p = 0;
-    tcount = atoi(s);
-    s = p + 1;
-    count = atoi(s);
-    handleReply(handle, code, tcount, count);
+    // a payload shorter than its count is an error, the same as for SEND
+    if (handleReply(handle, code, tcount, count) != ESP_OK)
+    {
+        sendResponse('E', ERROR_INVALID_SIZE);
+        return;
+    }
 
     sendResponse('S', ERROR_NONE);
 }
@@ -339,16 +877,35 @@ void doArg(char *parms)
     sendResponseT(value);
 }
 
+/* rate, answered at the old rate before the probe exchange */
+void doBaud(char *parms)
+{
+    parserNegotiateBaud(atoi(&parms[1]));
+}
+
 void doPoll(char *parms)
 {
     char *s;
     int filter;
+    bool report;
 
     s = &parms[1];
     filter = atoi(s);
     if (filter == 0)
         filter = -1;
-    
+
+    // connects that finished since the last poll, when not sent as events
+    for (int i = 0; i < CMD_CONNECTION; i++)
+    {
+        xSemaphoreTake(connLock, portMAX_DELAY);
+        report = ((Connections[i].state == CONN_OPEN) || (Connections[i].state == CONN_FAILED)) && !Connections[i].reported;
+        if (report)
+            Connections[i].reported = true;
+        xSemaphoreGive(connLock);
+        if (report)
+            connReport(&Connections[i]);
+    }
+
     polling(filter);
 
     sendResponse('S', ERROR_NONE);
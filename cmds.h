@@ -10,11 +10,54 @@
 #define CMD_PATH       32
 
 #define CMD_CONNECTION 4
-#define CMD_RX_BUFFER  1024
+#define CMD_RX_BUFFER  1024   // most one RECV returns, a larger count is clamped
 #define CMD_TX_BUFFER  1024
+#define CMD_CONNECT_TIMEOUT_MS 10000
+
+// empty 200 ms uart reads in a row that end a SEND or REPLY short of its count
+#define CMD_SEND_IDLE 10
 
 #define CMD_HANDLE     (CMD_LISTENER + CMD_CONNECTION)
 
+#define CMD_PARMS      256
+
+/* command runs on the parser task because it reads its payload from the uart */
+#define CMD_INLINE     0x01
+/* first argument is a handle, tagged commands are kept in order per handle */
+#define CMD_BYHANDLE   0x02
+/* changes the uart under every lane, waits for all of them first */
+#define CMD_BARRIER    0x04
+
+/*
+ * Command table: name, token byte, handler, minimum argument count, flags.
+ * Tokens run down from 0xEF without gaps and a NULL handler answers
+ * ERROR_UNIMPLEMENTED, so a new command only needs a line here.
+ *
+ * A command sent as <start>#id,CMD:args is tagged. Tagged commands are
+ * queued to worker lanes so several can be outstanding, and their
+ * responses come back as <start>#id=S,...
+ */
+#define CMD_TABLE(X) \
+    X(JOIN,     0xEF,   doJoin,     2,  0) \
+    X(CHECK,    0xEE,   doGet,      1,  0) \
+    X(SET,      0xED,   doSet,      2,  CMD_INLINE) \
+    X(POLL,     0xEC,   doPoll,     0,  0) \
+    X(PATH,     0xEB,   NULL,       0,  0) \
+    X(SEND,     0xEA,   doSend,     2,  CMD_INLINE | CMD_BYHANDLE) \
+    X(RECV,     0xE9,   doRecv,     2,  CMD_BYHANDLE) \
+    X(CLOSE,    0xE8,   doClose,    1,  CMD_BYHANDLE) \
+    X(LISTEN,   0xE7,   doListen,   1,  0) \
+    X(ARG,      0xE6,   doArg,      2,  CMD_BYHANDLE) \
+    X(REPLY,    0xE5,   doReply,    3,  CMD_INLINE | CMD_BYHANDLE) \
+    X(CONNECT,  0xE4,   doConnect,  2,  0) \
+    X(APSCAN,   0xE3,   NULL,       0,  0) \
+    X(APGET,    0xE2,   NULL,       0,  0) \
+    X(FINFO,    0xE1,   NULL,       0,  0) \
+    X(FCOUNT,   0xE0,   NULL,       0,  0) \
+    X(FRUN,     0xDF,   NULL,       0,  0) \
+    X(UDP,      0xDE,   NULL,       0,  0) \
+    X(BAUD,     0xDD,   doBaud,     1,  CMD_INLINE | CMD_BARRIER)
+
 enum
 {
     TKN_START = 0xFE,
@@ -35,33 +78,39 @@ enum
 
     // gap for more tokens
 
-    TKN_JOIN = 0xEF,
-    TKN_CHECK = 0xEE,
-    TKN_SET = 0xED,
-    TKN_POLL = 0xEC,
-    TKN_PATH = 0xEB,
-    TKN_SEND = 0xEA,
-    TKN_RECV = 0xE9,
-    TKN_CLOSE = 0xE8,
-    TKN_LISTEN = 0xE7,
-    TKN_ARG = 0xE6,
-    TKN_REPLY = 0xE5,
-    TKN_CONNECT = 0xE4,
-    TKN_APSCAN = 0xE3,
-    TKN_APGET = 0xE2,
-    TKN_FINFO = 0xE1,
-    TKN_FCOUNT = 0xE0,
-    TKN_FRUN = 0xDF,
-    TKN_UDP = 0xDE,
+#define CMD_TOKEN(n, t, h, a, f) TKN_##n = t,
+    CMD_TABLE(CMD_TOKEN)
+#undef CMD_TOKEN
 
     MIN_TOKEN = 0x80
 
 };
 
+typedef struct
+{
+    const char *name;       // token text
+    uint8_t token;          // token byte
+    void (*handler)(char*); // NULL if not implemented
+    int8_t args;            // minimum comma separated arguments
+    uint8_t flags;          // CMD_INLINE, CMD_BYHANDLE, CMD_BARRIER
+    uint32_t count;         // invocations
+    int64_t time;           // cumulative handler time in us
+} cmd_entry;
+
 typedef struct cmd_hdr cmd_hdr;
 typedef struct cmd_listener cmd_listener;
 typedef struct cmd_connection cmd_connection;
 
+typedef struct
+{
+    int64_t opened;         // connect time in us
+    uint32_t txBytes;       // sent upstream
+    uint32_t rxBytes;       // received from upstream
+    uint32_t sends;
+    uint32_t recvs;
+    uint32_t errors;        // failed sends and receives
+} cmd_conn_stats;
+
 enum
 {
     ERROR_NONE = 0,
@@ -83,6 +132,65 @@ enum
 };
 
 
+/**
+ * @brief Build the command lookup tables
+ */
+void cmdInit(void);
+
+/**
+ * @brief Find command by token text
+ * @param name token text
+ * @return command or NULL
+ */
+cmd_entry *cmdFindName(const char *name);
+
+/**
+ * @brief Find command by token byte
+ * @param token byte
+ * @return command or NULL
+ */
+cmd_entry *cmdFindToken(uint8_t token);
+
+/**
+ * @brief Run a parsed command
+ * @param parms token byte followed by arguments
+ */
+void cmdDispatch(char *parms);
+
+/**
+ * @brief Run a parsed command now or queue it to a worker lane
+ * @param tag sequence id of the command or 0 for untagged
+ * @param parms token byte followed by arguments
+ */
+void cmdSubmit(int tag, char *parms);
+
+/**
+ * @brief Wait until every lane has finished its queued commands,
+ * the same barrier BAUD waits on, parser task only
+ */
+void cmdWaitAll(void);
+
+/**
+ * @brief Sequence id of the command running on this task
+ * @return tag or 0
+ */
+int cmdGetTag(void);
+
+/**
+ * @brief Command table with statistics
+ * @param count returns number of commands
+ * @return first table entry
+ */
+cmd_entry *cmdTable(int *count);
+
+/**
+ * @brief Counters of an open connection
+ * @param handle connection handle
+ * @param stats filled in
+ * @return 0 or -1 if the handle is not open
+ */
+int cmdConnectionStats(int handle, cmd_conn_stats *stats);
+
 void doNothing(char*);
 void doJoin(char*);
 void doSend(char*);
@@ -93,3 +201,4 @@ void doListen(char*);
 void doReply(char*);
 void doArg(char*);
 void doPoll(char*);
+void doBaud(char*);
@@ -13,12 +13,25 @@
 #include "esp_log.h"
 #include "cmds.h"
 #include "config.h"
+#include "serbridge.h"
 
 #define MCU_RESET_PIN       12
 #define LED_CONN_PIN        16
 #define LOADER_BAUD_RATE    115200
 #define BAUD_RATE           115200
 #define ONE_STOP_BIT        1
+#define UART_RTS_PIN        22
+#define UART_CTS_PIN        19
+#define UART_RX_BUFFER      4096
+#define BRIDGE_CLIENTS      4
+#define BRIDGE_BATCH        1460
+#define SCROLLBACK          4096
+#define CAPTURE_SIZE        65536
+#define UDP_IDLE            2000
+#define BRIDGE_DELAY        2000
+#define KEEP_IDLE           5
+#define KEEP_INTERVAL       1
+#define KEEP_COUNT          3
 #define FLASH_VERSION       2
 
 static const char* TAG = "config";
@@ -36,7 +49,34 @@ FlashConfig flashDefault = {
   .start                = TKN_START,
   .events               = 1,
   .dbg_enable           = 0,
-  .loader               = 0
+  .loader               = 0,
+  .flow_ctrl            = FLOW_NONE,
+  .rts_pin              = UART_RTS_PIN,
+  .cts_pin              = UART_CTS_PIN,
+  .rx_buffer            = UART_RX_BUFFER,
+  .bridge_clients       = BRIDGE_CLIENTS,
+  .bridge_merge         = BRIDGE_MERGE_ONE,
+  .bridge_mode          = BRIDGE_INTERACTIVE,
+  .bridge_batch         = BRIDGE_BATCH,
+  .bridge_delay         = BRIDGE_DELAY,
+  .scrollback           = SCROLLBACK,
+  .replay               = 0,
+  .capture              = 0,
+  .capture_size         = CAPTURE_SIZE,
+  .udp_port             = 0,
+  .udp_peer_ip          = 0,
+  .udp_peer_port        = 0,
+  .udp_frame            = UDP_FRAME_DELIMITER,
+  .udp_delimiter        = '\n',
+  .udp_idle             = UDP_IDLE,
+  .udp_size             = BRIDGE_UDP_MAX,
+  .bridge_compress      = 0,
+  .bridge_policy        = BRIDGE_DROP_OLDEST,
+  .keep_idle            = KEEP_IDLE,
+  .keep_interval        = KEEP_INTERVAL,
+  .keep_count           = KEEP_COUNT,
+  .bridge_idle          = 0,
+  .bridge_takeover      = 0
 };
 
 char NVSLabel[] = "parallax";
@@ -65,6 +105,33 @@ esp_err_t configSave(void)
   err = nvs_set_i8(my_handle, "events", flashConfig.events);
   err = nvs_set_i8(my_handle, "dbgenable", flashConfig.dbg_enable);
   err = nvs_set_i8(my_handle, "loader", flashConfig.loader);
+  err = nvs_set_i8(my_handle, "flowctrl", flashConfig.flow_ctrl);
+  err = nvs_set_i8(my_handle, "rtspin", flashConfig.rts_pin);
+  err = nvs_set_i8(my_handle, "ctspin", flashConfig.cts_pin);
+  err = nvs_set_i32(my_handle, "rxbuffer", flashConfig.rx_buffer);
+  err = nvs_set_i8(my_handle, "bridgeclients", flashConfig.bridge_clients);
+  err = nvs_set_i8(my_handle, "bridgemerge", flashConfig.bridge_merge);
+  err = nvs_set_i8(my_handle, "bridgepolicy", flashConfig.bridge_policy);
+  err = nvs_set_i8(my_handle, "bridgecompress", flashConfig.bridge_compress);
+  err = nvs_set_i32(my_handle, "keepidle", flashConfig.keep_idle);
+  err = nvs_set_i32(my_handle, "keepinterval", flashConfig.keep_interval);
+  err = nvs_set_i32(my_handle, "keepcount", flashConfig.keep_count);
+  err = nvs_set_i32(my_handle, "bridgeidle", flashConfig.bridge_idle);
+  err = nvs_set_i8(my_handle, "takeover", flashConfig.bridge_takeover);
+  err = nvs_set_i8(my_handle, "bridgemode", flashConfig.bridge_mode);
+  err = nvs_set_i32(my_handle, "bridgebatch", flashConfig.bridge_batch);
+  err = nvs_set_i32(my_handle, "bridgedelay", flashConfig.bridge_delay);
+  err = nvs_set_i32(my_handle, "scrollback", flashConfig.scrollback);
+  err = nvs_set_i32(my_handle, "replay", flashConfig.replay);
+  err = nvs_set_i8(my_handle, "capture", flashConfig.capture);
+  err = nvs_set_i32(my_handle, "capturesize", flashConfig.capture_size);
+  err = nvs_set_i32(my_handle, "udpport", flashConfig.udp_port);
+  err = nvs_set_u32(my_handle, "udppeerip", flashConfig.udp_peer_ip);
+  err = nvs_set_i32(my_handle, "udppeerport", flashConfig.udp_peer_port);
+  err = nvs_set_i8(my_handle, "udpframe", flashConfig.udp_frame);
+  err = nvs_set_u8(my_handle, "udpdelimiter", flashConfig.udp_delimiter);
+  err = nvs_set_i32(my_handle, "udpidle", flashConfig.udp_idle);
+  err = nvs_set_i32(my_handle, "udpsize", flashConfig.udp_size);
   err = nvs_set_str(my_handle, "modulename", flashConfig.module_name);
   err = nvs_commit(my_handle);
   nvs_close(my_handle);
@@ -104,6 +171,8 @@ esp_err_t configRestore(void)
     return ESP_ERR_INVALID_VERSION;
   }
 
+  // keys added since the config was saved keep their defaults
+  memcpy(&flashConfig, &flashDefault, sizeof(FlashConfig));
   flashConfig.version = ver;
   err = nvs_get_i32(my_handle, "loaderbaudrate", &flashConfig.loader_baud_rate);
   err = nvs_get_i32(my_handle, "baudrate", &flashConfig.baud_rate);
@@ -115,6 +184,33 @@ esp_err_t configRestore(void)
   err = nvs_get_i8(my_handle, "events", &flashConfig.events);
   err = nvs_get_i8(my_handle, "dbgenable", &flashConfig.dbg_enable);
   err = nvs_get_i8(my_handle, "loader", &flashConfig.loader);
+  err = nvs_get_i8(my_handle, "flowctrl", &flashConfig.flow_ctrl);
+  err = nvs_get_i8(my_handle, "rtspin", &flashConfig.rts_pin);
+  err = nvs_get_i8(my_handle, "ctspin", &flashConfig.cts_pin);
+  err = nvs_get_i32(my_handle, "rxbuffer", &flashConfig.rx_buffer);
+  err = nvs_get_i8(my_handle, "bridgeclients", &flashConfig.bridge_clients);
+  err = nvs_get_i8(my_handle, "bridgemerge", &flashConfig.bridge_merge);
+  err = nvs_get_i8(my_handle, "bridgepolicy", &flashConfig.bridge_policy);
+  err = nvs_get_i8(my_handle, "bridgecompress", &flashConfig.bridge_compress);
+  err = nvs_get_i32(my_handle, "keepidle", &flashConfig.keep_idle);
+  err = nvs_get_i32(my_handle, "keepinterval", &flashConfig.keep_interval);
+  err = nvs_get_i32(my_handle, "keepcount", &flashConfig.keep_count);
+  err = nvs_get_i32(my_handle, "bridgeidle", &flashConfig.bridge_idle);
+  err = nvs_get_i8(my_handle, "takeover", &flashConfig.bridge_takeover);
+  err = nvs_get_i8(my_handle, "bridgemode", &flashConfig.bridge_mode);
+  err = nvs_get_i32(my_handle, "bridgebatch", &flashConfig.bridge_batch);
+  err = nvs_get_i32(my_handle, "bridgedelay", &flashConfig.bridge_delay);
+  err = nvs_get_i32(my_handle, "scrollback", &flashConfig.scrollback);
+  err = nvs_get_i32(my_handle, "replay", &flashConfig.replay);
+  err = nvs_get_i8(my_handle, "capture", &flashConfig.capture);
+  err = nvs_get_i32(my_handle, "capturesize", &flashConfig.capture_size);
+  err = nvs_get_i32(my_handle, "udpport", &flashConfig.udp_port);
+  err = nvs_get_u32(my_handle, "udppeerip", &flashConfig.udp_peer_ip);
+  err = nvs_get_i32(my_handle, "udppeerport", &flashConfig.udp_peer_port);
+  err = nvs_get_i8(my_handle, "udpframe", &flashConfig.udp_frame);
+  err = nvs_get_u8(my_handle, "udpdelimiter", &flashConfig.udp_delimiter);
+  err = nvs_get_i32(my_handle, "udpidle", &flashConfig.udp_idle);
+  err = nvs_get_i32(my_handle, "udpsize", &flashConfig.udp_size);
   err = nvs_get_u32(my_handle, "seq", &flashConfig.seq);
   sz = sizeof(flashConfig.module_name);
   err = nvs_get_str(my_handle, "modulename", flashConfig.module_name, &sz);
@@ -18,8 +18,42 @@ typedef struct
   int8_t   events;
   int8_t   dbg_enable;
   int8_t   loader;
+  int8_t   flow_ctrl;       // FLOW_NONE, FLOW_RTS_CTS, FLOW_XON_XOFF
+  int8_t   rts_pin;
+  int8_t   cts_pin;
+  int32_t  rx_buffer;       // uart driver receive buffer bytes
+  int8_t   bridge_clients;  // serial bridge client limit
+  int8_t   bridge_merge;    // BRIDGE_MERGE_ONE or BRIDGE_MERGE_ALL
+  int8_t   bridge_mode;     // BRIDGE_INTERACTIVE, BRIDGE_THROUGHPUT or BRIDGE_LINE
+  int32_t  bridge_batch;    // bytes that end a batch
+  int32_t  bridge_delay;    // microseconds that end a batch
+  int32_t  scrollback;      // bytes of uart output kept for late joiners
+  int32_t  replay;          // scrollback bytes sent to a new client
+  int8_t   capture;         // capture uart traffic to flash from boot
+  int32_t  capture_size;    // bytes per capture file before rotating
+  int32_t  udp_port;        // udp bridge port, 0 for none
+  uint32_t udp_peer_ip;     // network order, 0 for the last sender
+  int32_t  udp_peer_port;
+  int8_t   udp_frame;       // UDP_FRAME_DELIMITER, UDP_FRAME_IDLE or UDP_FRAME_SIZE
+  uint8_t  udp_delimiter;
+  int32_t  udp_idle;        // microseconds of quiet that end a frame
+  int32_t  udp_size;        // bytes that end a frame
+  int8_t   bridge_compress; // let telnet clients ask for compressed output
+  int8_t   bridge_policy;   // BRIDGE_DROP_OLDEST, BRIDGE_DISCONNECT or BRIDGE_BACKPRESSURE
+  int32_t  keep_idle;       // seconds quiet before keepalive probes
+  int32_t  keep_interval;   // seconds between probes
+  int32_t  keep_count;      // unanswered probes that drop the client
+  int32_t  bridge_idle;     // seconds without traffic that drop the client, 0 for never
+  int8_t   bridge_takeover; // a new client replaces the oldest when full
 } FlashConfig;
 
+enum
+{
+  FLOW_NONE = 0,
+  FLOW_RTS_CTS = 1,
+  FLOW_XON_XOFF = 2
+};
+
 extern FlashConfig flashConfig;
 extern FlashConfig flashDefault;
 
@@ -0,0 +1,176 @@
+/**
+ * @file dnscache.c
+ * @brief cache of failed host name lookups for outbound connections
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "dnscache.h"
+
+static const char *TAG = "dnscache";
+
+// a name that failed to resolve
+typedef struct
+{
+    char name[DNS_CACHE_NAME];  // empty when unused
+    int64_t expires;            // us
+    int64_t used;               // last hit, the oldest is replaced first
+} dns_entry;
+
+static dns_entry Entries[DNS_CACHE_ENTRIES];
+static dns_cache_stats Stats;
+static SemaphoreHandle_t cacheLock;
+static dns_resolver Resolver;
+
+
+static int dnsResolve(const char *host, uint32_t *addr)
+{
+    struct addrinfo *res;
+    int err;
+
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+    };
+
+    err = getaddrinfo(host, NULL, &hints, &res);
+    if ((err != 0) || (res == NULL))
+    {
+        ESP_LOGE(TAG, "DNS lookup failed err=%d", err);
+        return -1;
+    }
+
+    *addr = ((struct sockaddr_in*)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    return 0;
+}
+
+/**
+ * @brief find a live entry, called with the lock held
+ * @param host name
+ * @param now current time
+ * @return entry or NULL
+ */
+static dns_entry *dnsFind(const char *host, int64_t now)
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        if ((Entries[i].name[0] != 0) && (Entries[i].expires > now) && (strcmp(Entries[i].name, host) == 0))
+            return &Entries[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief store a failure, reusing the same name, a dead entry, or the least used one
+ * @param host name
+ * @param now current time
+ */
+static void dnsStore(const char *host, int64_t now)
+{
+    dns_entry *e = NULL;
+
+    for (int i = 0; (i < DNS_CACHE_ENTRIES) && (e == NULL); i++)
+    {
+        if ((Entries[i].name[0] != 0) && (strcmp(Entries[i].name, host) == 0))
+            e = &Entries[i];
+    }
+
+    for (int i = 0; (i < DNS_CACHE_ENTRIES) && (e == NULL); i++)
+    {
+        if ((Entries[i].name[0] == 0) || (Entries[i].expires <= now))
+            e = &Entries[i];
+    }
+
+    if (e == NULL)
+    {
+        e = &Entries[0];
+        for (int i = 1; i < DNS_CACHE_ENTRIES; i++)
+        {
+            if (Entries[i].used < e->used)
+                e = &Entries[i];
+        }
+        Stats.evictions++;
+    }
+
+    strcpy(e->name, host);
+    e->used = now;
+    e->expires = now + (int64_t)DNS_NEGATIVE_TTL_S * 1000000;
+}
+
+void dnsCacheInit(dns_resolver resolver)
+{
+    if (cacheLock == NULL)
+        cacheLock = xSemaphoreCreateMutex();
+
+    Resolver = resolver != NULL ? resolver : dnsResolve;
+    dnsCacheFlush();
+    memset(&Stats, 0, sizeof(Stats));
+}
+
+int dnsCacheLookup(const char *host, uint32_t *addr)
+{
+    dns_entry *e;
+    int64_t now;
+    bool keep;
+    int err;
+
+    // names too long to keep go straight to the resolver
+    keep = strlen(host) < DNS_CACHE_NAME;
+
+    now = esp_timer_get_time();
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    Stats.lookups++;
+    e = keep ? dnsFind(host, now) : NULL;
+    if (e != NULL)
+    {
+        e->used = now;
+        Stats.negativeHits++;
+        xSemaphoreGive(cacheLock);
+        return -1;
+    }
+    Stats.resolves++;
+    xSemaphoreGive(cacheLock);
+
+    // the lookup can take seconds, other names stay answerable meanwhile
+    err = Resolver(host, addr);
+
+    if ((err != 0) && keep)
+    {
+        xSemaphoreTake(cacheLock, portMAX_DELAY);
+        dnsStore(host, esp_timer_get_time());
+        xSemaphoreGive(cacheLock);
+    }
+
+    return err;
+}
+
+void dnsCacheFlush(void)
+{
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    memset(Entries, 0, sizeof(Entries));
+    xSemaphoreGive(cacheLock);
+}
+
+void dnsCacheStats(dns_cache_stats *stats)
+{
+    if (cacheLock == NULL)
+    {
+        memset(stats, 0, sizeof(dns_cache_stats));
+        return;
+    }
+
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    *stats = Stats;
+    xSemaphoreGive(cacheLock);
+}
@@ -0,0 +1,65 @@
+/**
+ * @file dnscache.h
+ * @brief cache of failed host name lookups for outbound connections
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef DNSCACHE_H
+#define DNSCACHE_H
+
+#include <stdint.h>
+
+/*
+ * lwIP keeps answers in its own table for the ttl of each record, and
+ * getaddrinfo does not pass that ttl up, so only failures are kept here.
+ * lwIP asks the server again for every lookup of a name that failed.
+ */
+#define DNS_CACHE_ENTRIES   8
+#define DNS_CACHE_NAME      64
+#define DNS_NEGATIVE_TTL_S  30      // how long a failed name stays failed
+
+/**
+ * @brief resolver behind the cache
+ * @param host name to look up
+ * @param addr set to the address in network order
+ * @return 0 or -1 if the name does not resolve
+ */
+typedef int (*dns_resolver)(const char *host, uint32_t *addr);
+
+// counters for the whole cache
+typedef struct
+{
+    uint32_t lookups;
+    uint32_t resolves;          // lookups passed to the resolver
+    uint32_t negativeHits;      // answered from a cached failure
+    uint32_t evictions;         // live entries replaced to make room
+} dns_cache_stats;
+
+/**
+ * @brief Set up the cache, clearing entries and counters
+ * @param resolver upstream lookup or NULL for getaddrinfo
+ */
+void dnsCacheInit(dns_resolver resolver);
+
+/**
+ * @brief Resolve a host name unless it failed recently
+ * @param host name to look up
+ * @param addr set to the address in network order
+ * @return 0 or -1 if the name does not resolve
+ */
+int dnsCacheLookup(const char *host, uint32_t *addr);
+
+/**
+ * @brief Forget every entry
+ */
+void dnsCacheFlush(void);
+
+/**
+ * @brief Cache counters
+ * @param stats filled in
+ */
+void dnsCacheStats(dns_cache_stats *stats);
+
+#endif
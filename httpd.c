@@ -21,6 +21,7 @@
 #include "esp_spiffs.h"
 #include "esp_http_server.h"
 #include "esp_http_client.h"
+#include "esp_timer.h"
 #include "esp_wifi_types.h"
 #include "esp_wifi.h"
 #include "driver/uart.h"
@@ -33,14 +34,20 @@
 #include "json.h"
 #include "cmds.h"
 #include "status.h"
+#include "wsserial.h"
+#include "serbridge.h"
+#include "txsched.h"
+#include "capture.h"
+#include "dnscache.h"
 
-#define MAXHANDLERS 26
+#define MAXHANDLERS 28
 
 typedef struct
 {
     const char* url;
     httpd_method_t meth;
     esp_err_t(*handler)(httpd_req_t* r);
+    bool ws;
 } HttpdBuiltInUrl;
 
 typedef struct
@@ -110,8 +117,46 @@ static cmd_def vars[] = {
     {   "cmd-events",       int8GetHandler,     int8SetHandler,     &flashConfig.events             },
     {   "cmd-enable",       int8GetHandler,     int8SetHandler,     &flashConfig.enable             },
     {   "cmd-loader",       int8GetHandler,     int8SetHandler,     &flashConfig.loader             },
+    {   "cmd-framing",      getFraming,         setFraming,         NULL                            },
+    {   "cmd-transparent",  getTransparent,     setTransparent,     NULL                            },
+    {   "tx-depth",         getTxDepth,         NULL,               NULL                            },
+    {   "tx-stall-us",      getTxStall,         NULL,               NULL                            },
     {   "loader-baud-rate", intGetHandler,      setLoaderBaudrate,  &flashConfig.loader_baud_rate   },
     {   "baud-rate",        intGetHandler,      setBaudrate,        &flashConfig.baud_rate          },
+    {   "uart-flow-ctrl",   int8GetHandler,     setFlowControl,     &flashConfig.flow_ctrl          },
+    {   "uart-rts-pin",     int8GetHandler,     int8SetHandler,     &flashConfig.rts_pin            },
+    {   "uart-cts-pin",     int8GetHandler,     int8SetHandler,     &flashConfig.cts_pin            },
+    {   "uart-rx-buffer",   intGetHandler,      intSetHandler,      &flashConfig.rx_buffer          },
+    {   "uart-overruns",    getUartOverruns,    NULL,               NULL                            },
+    {   "uart-errors",      getUartErrors,      NULL,               NULL                            },
+    {   "bridge-clients",   int8GetHandler,     int8SetHandler,     &flashConfig.bridge_clients     },
+    {   "bridge-merge",     int8GetHandler,     int8SetHandler,     &flashConfig.bridge_merge       },
+    {   "bridge-mode",      int8GetHandler,     int8SetHandler,     &flashConfig.bridge_mode        },
+    {   "bridge-batch",     intGetHandler,      intSetHandler,      &flashConfig.bridge_batch       },
+    {   "bridge-delay-us",  intGetHandler,      intSetHandler,      &flashConfig.bridge_delay       },
+    {   "bridge-scroll",    intGetHandler,      intSetHandler,      &flashConfig.scrollback         },
+    {   "bridge-replay",    intGetHandler,      intSetHandler,      &flashConfig.replay             },
+    {   "bridge-policy",    int8GetHandler,     int8SetHandler,     &flashConfig.bridge_policy      },
+    {   "bridge-keep-idle", intGetHandler,      intSetHandler,      &flashConfig.keep_idle          },
+    {   "bridge-keep-intvl",intGetHandler,      intSetHandler,      &flashConfig.keep_interval      },
+    {   "bridge-keep-count",intGetHandler,      intSetHandler,      &flashConfig.keep_count         },
+    {   "bridge-idle",      intGetHandler,      intSetHandler,      &flashConfig.bridge_idle        },
+    {   "bridge-takeover",  int8GetHandler,     int8SetHandler,     &flashConfig.bridge_takeover    },
+    {   "bridge-depth",     getBridgeDepth,     NULL,               NULL                            },
+    {   "bridge-dropped",   getBridgeDropped,   NULL,               NULL                            },
+    {   "bridge-compress",  int8GetHandler,     int8SetHandler,     &flashConfig.bridge_compress    },
+    {   "bridge-ratio",     getBridgeRatio,     NULL,               NULL                            },
+    {   "bridge-lz-us",     getBridgeLzTime,    NULL,               NULL                            },
+    {   "capture-enable",   int8GetHandler,     setCapture,         &flashConfig.capture            },
+    {   "capture-size",     intGetHandler,      intSetHandler,      &flashConfig.capture_size       },
+    {   "capture-dropped",  getCaptureDropped,  NULL,               NULL                            },
+    {   "capture-rate",     getCaptureRate,     NULL,               NULL                            },
+    {   "udp-port",         intGetHandler,      intSetHandler,      &flashConfig.udp_port           },
+    {   "udp-peer",         getUdpPeer,         setUdpPeer,         NULL                            },
+    {   "udp-frame",        int8GetHandler,     int8SetHandler,     &flashConfig.udp_frame          },
+    {   "udp-delimiter",    uint8GetHandler,    uint8SetHandler,    &flashConfig.udp_delimiter      },
+    {   "udp-idle-us",      intGetHandler,      intSetHandler,      &flashConfig.udp_idle           },
+    {   "udp-size",         intGetHandler,      intSetHandler,      &flashConfig.udp_size           },
     {   "dbg-baud-rate",    intGetHandler,      setDbgBaudrate,     &flashConfig.dbg_baud_rate      },
     {   "dbg-enable",       int8GetHandler,     int8SetHandler,     &flashConfig.dbg_enable         },
     {   "reset-pin",        int8GetHandler,     setResetPin,        &flashConfig.reset_pin          },
@@ -887,6 +932,169 @@ static esp_err_t propModuleInfo(httpd_req_t* req)
     return ESP_OK;
 }
 
+static esp_err_t propCommands(httpd_req_t* req)
+{
+    char *buffer;
+    char value[24];
+    cmd_entry *cmd;
+    int count;
+
+    buffer = ((struct file_server_data*)req->user_ctx)->scratch;
+    memset(buffer, 0, SCRATCH_BUFSIZE);
+    cmd = cmdTable(&count);
+    json_init(buffer);
+    sprintf(value, "%d", count);
+    json_putDec("count", value);
+    json_putArray("commands");
+    for (int i = 0; i < count; i++)
+    {
+        if (i != 0)
+            json_putMore();
+        json_putStr("name", (char*)cmd[i].name);
+        sprintf(value, "%lu", (unsigned long)cmd[i].count);
+        json_putDec("calls", value);
+        sprintf(value, "%lld", (long long)cmd[i].time);
+        json_putDec("time-us", value);
+    }
+    json_putArray(NULL);
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_sendstr(req, buffer);
+    return ESP_OK;
+}
+
+static void statPut(char *name, uint64_t value)
+{
+    char text[24];
+
+    sprintf(text, "%llu", (unsigned long long)value);
+    json_putDec(name, text);
+}
+
+static void statRing(char *name, ring_t *ring)
+{
+    json_putObject(name);
+    statPut("depth", ringUsed(ring));
+    statPut("high", ring->high);
+    statPut("stalls", ring->stalls);
+    json_putObject(NULL);
+}
+
+static esp_err_t propStats(httpd_req_t* req)
+{
+    char *buffer;
+    char name[16];
+    uart_counters uart;
+    tx_stats tx;
+    bridge_stats bridge;
+    capture_stats capture;
+    cmd_conn_stats conn;
+    dns_cache_stats dns;
+    int i, count;
+
+    // each module hands over a copy, nothing here holds up the data path
+    parserUartCounters(&uart);
+    txGetStats(&tx);
+    serbridgeStats(&bridge);
+    captureStats(&capture);
+    dnsCacheStats(&dns);
+
+    buffer = ((struct file_server_data*)req->user_ctx)->scratch;
+    memset(buffer, 0, SCRATCH_BUFSIZE);
+    json_init(buffer);
+
+    json_putObject("uart");
+    statPut("rx-bytes", uart.rxBytes);
+    statPut("tx-bytes", uart.txBytes);
+    statPut("fifo-overflow", uart.fifoOverflow);
+    statPut("buffer-full", uart.bufferFull);
+    statPut("frame-errors", uart.frameErrors);
+    statPut("parity-errors", uart.parityErrors);
+    statPut("mode-switches", uart.modeSwitches);
+    json_putObject(NULL);
+
+    json_putObject("tx");
+    statPut("depth", tx.depth);
+    statPut("high", tx.high);
+    statPut("messages", tx.messages);
+    statPut("bytes", tx.bytes);
+    statPut("stalls", tx.stalls);
+    statPut("stall-us", tx.stallTime);
+    json_putObject(NULL);
+
+    statRing("telnet-ring", receiveRing(RECEIVE_TELNET));
+    statRing("ws-ring", receiveRing(RECEIVE_WS));
+
+    json_putObject("bridge");
+    statPut("clients", bridge.clients);
+    statPut("connects", bridge.connects);
+    statPut("closes", bridge.closes);
+    statPut("disconnects", bridge.disconnects);
+    statPut("rx-bytes", bridge.tcpIn);
+    statPut("tx-bytes", bridge.tcpOut);
+    statPut("depth", bridge.depth);
+    statPut("high", bridge.high);
+    statPut("dropped", bridge.dropped);
+    statPut("lz-in", bridge.lzIn);
+    statPut("lz-out", bridge.lzOut);
+    statPut("lz-us", bridge.lzTime);
+    statPut("udp-frames", bridge.udpFrames);
+    statPut("udp-lost", bridge.udpLost);
+    json_putObject("latency-us");
+    for (i = 0; i < BRIDGE_LATENCY_BUCKETS - 1; i++)
+    {
+        sprintf(name, "%d", BRIDGE_LATENCY_MIN << i);
+        statPut(name, bridge.latency[i]);
+    }
+    statPut("inf", bridge.latency[i]);
+    json_putObject(NULL);
+    json_putObject(NULL);
+
+    json_putObject("ws");
+    statPut("dropped", wsSerialDropped());
+    statPut("input-dropped", wsSerialInputDropped());
+    json_putObject(NULL);
+
+    json_putObject("capture");
+    statPut("written", capture.written);
+    statPut("dropped", capture.dropped);
+    statPut("rate", capture.rate);
+    json_putObject(NULL);
+
+    json_putObject("dns");
+    statPut("lookups", dns.lookups);
+    statPut("resolves", dns.resolves);
+    statPut("negative-hits", dns.negativeHits);
+    statPut("evictions", dns.evictions);
+    json_putObject(NULL);
+
+    // open upstream connections by handle, the count keeps the object from being empty
+    count = 0;
+    for (i = 0; i < CMD_CONNECTION; i++)
+        if (cmdConnectionStats(i, &conn) == 0)
+            count++;
+    json_putObject("connections");
+    statPut("open", count);
+    for (i = 0; i < CMD_CONNECTION; i++)
+    {
+        if (cmdConnectionStats(i, &conn) != 0)
+            continue;
+        sprintf(name, "%d", i);
+        json_putObject(name);
+        statPut("open-ms", (esp_timer_get_time() - conn.opened) / 1000);
+        statPut("tx-bytes", conn.txBytes);
+        statPut("rx-bytes", conn.rxBytes);
+        statPut("sends", conn.sends);
+        statPut("recvs", conn.recvs);
+        statPut("errors", conn.errors);
+        json_putObject(NULL);
+    }
+    json_putObject(NULL);
+
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_sendstr(req, buffer);
+    return ESP_OK;
+}
+
 static esp_err_t propSaveSettings(httpd_req_t* req)
 {
     if (configSave() != 0)
@@ -1266,6 +1474,8 @@ HttpdBuiltInUrl builtInUrls[] = {
     {"/upload/*", HTTP_POST, upload_post_handler},
     {"/delete/*", HTTP_POST, delete_post_handler},
     {"/wx/module-info", HTTP_GET, propModuleInfo},
+    {"/wx/commands", HTTP_GET, propCommands},
+    {"/wx/stats", HTTP_GET, propStats},
     {"/wx/setting", HTTP_GET, PropSettings},
     {"/wx/setting", HTTP_POST, PropSettings},
     {"/wx/save-settings", HTTP_POST, propSaveSettings},
@@ -1276,6 +1486,9 @@ HttpdBuiltInUrl builtInUrls[] = {
     {"/websocket", HTTP_GET, redirect},
     {"/websocket/", HTTP_GET, redirect},
     {"/log/text", HTTP_GET, ajaxLog},
+#if CONFIG_HTTPD_WS_SUPPORT
+    {"/ws/serial", HTTP_GET, wsSerialHandler, true},
+#endif
     {"/wifi/wifiscan", HTTP_GET, WiFiScan},
     {"/wifi/connect", HTTP_POST, WiFiConnect},
     {"/wifi/connstatus", HTTP_GET, WiFiConnStatus},
@@ -1394,29 +1607,65 @@ esp_err_t handleReply(int handle, char *code, int tcount, int count)
     httpd_handle_t hd;
     int fd;
     char Buffer[1024];
-    int i, t;
+    int i, t, excess, idle;
+    esp_err_t err;
 
     hd = UsrReq[handle].hd;
     fd = UsrReq[handle].fd;
 
     t = 0;
+    excess = 0;
+
+    if (count > sizeof(Buffer))
+    {
+        excess = count - sizeof(Buffer);
+        count = sizeof(Buffer);
+    }
 
     i = sprintf(Buffer, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n\r\n", count);
     i = httpd_socket_send(hd, fd, Buffer, i, 0);
 
+    // a Propeller that stops short ends the reply after the same idle time as SEND
+    err = ESP_OK;
+    idle = 0;
     while (count > t)
     {
-        i = receiveBytes(Buffer, count);
+        i = receiveBytes(&Buffer[t], count - t);
+        if ((i < 0) || ((i == 0) && (++idle >= CMD_SEND_IDLE)))
+        {
+            err = ESP_FAIL;
+            break;
+        }
         if (i > 0)
-            t = t + i;
+            idle = 0;
+        t = t + i;
     }
     
-    i = httpd_socket_send(hd, fd, Buffer, count, 0);
+    i = httpd_socket_send(hd, fd, Buffer, t, 0);
+
+    // the device still sends the whole reply, drop what did not fit
+    idle = 0;
+    while ((excess > 0) && (err == ESP_OK))
+    {
+        i = receiveBytes(Buffer, excess < sizeof(Buffer) ? excess : sizeof(Buffer));
+        if ((i < 0) || ((i == 0) && (++idle >= CMD_SEND_IDLE)))
+        {
+            err = ESP_FAIL;
+            break;
+        }
+        if (i > 0)
+            idle = 0;
+        excess -= i;
+    }
+
+    // the browser was promised Content-Length bytes, closing tells it the reply is cut short
+    if ((err != ESP_OK) && (t < count))
+        httpd_sess_trigger_close(hd, fd);
 
     UsrReq[handle].fd = -1;
     UsrReq[handle].method = ' ';
 
-    return ESP_OK;
+    return err;
 }
 
 esp_err_t getVar(int handle, char *name, char *value)
@@ -1449,6 +1698,17 @@ esp_err_t polling(int filter)
     return ESP_OK;
 }
 
+/**
+ * @brief close a session, letting the console forget it before lwIP hands its fd out again
+ * @param hd server
+ * @param fd session socket
+ */
+static void httpdClose(httpd_handle_t hd, int fd)
+{
+  wsSerialClose(fd);
+  close(fd);
+}
+
 /* Function to start the HTTP server */
 esp_err_t httpdInit(int port)
 {
@@ -1474,6 +1734,7 @@ esp_err_t httpdInit(int port)
   config.server_port = port;
   config.max_uri_handlers = MAXHANDLERS;
   config.uri_match_fn = httpd_uri_match_wildcard;
+  config.close_fn = httpdClose;
 
   ESP_LOGI(TAG, "Starting HTTP Server");
   if (httpd_start(&server, &config) != ESP_OK)
@@ -1489,11 +1750,17 @@ esp_err_t httpdInit(int port)
       hd.method = builtInUrls[i].meth;
       hd.handler = builtInUrls[i].handler;
       hd.user_ctx = server_data;
+#if CONFIG_HTTPD_WS_SUPPORT
+      hd.is_websocket = builtInUrls[i].ws;
+      hd.handle_ws_control_frames = false;
+      hd.supported_subprotocol = NULL;
+#endif
 
       httpd_register_uri_handler(server, &hd);
       i++;
   }
 
+  wsSerialInit(server);
   memset(UsrReq, 0, sizeof(UsrReq));
 
   return ESP_OK;
@@ -1520,11 +1787,17 @@ esp_err_t httpRestart()
       hd.method = builtInUrls[i].meth;
       hd.handler = builtInUrls[i].handler;
       hd.user_ctx = server_data;
+#if CONFIG_HTTPD_WS_SUPPORT
+      hd.is_websocket = builtInUrls[i].ws;
+      hd.handle_ws_control_frames = false;
+      hd.supported_subprotocol = NULL;
+#endif
 
       httpd_register_uri_handler(server, &hd);
       i++;
   }
 
+  wsSerialInit(server);
   memset(UsrReq, 0, sizeof(UsrReq));
 
   return ESP_OK;
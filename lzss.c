@@ -0,0 +1,183 @@
+/**
+ * @file lzss.c
+ * @brief small window LZSS for bridge output, builds on the host as well
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <string.h>
+#include "lzss.h"
+
+#define LZSS_NONE   0xFFFF
+
+
+static int lzssHash(const uint8_t *p)
+{
+    return (((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u) >> 23;
+}
+
+void lzssInit(lzss_encoder *z)
+{
+    memset(z->head, 0xFF, sizeof(z->head));
+    z->hist = 0;
+}
+
+int lzssEncode(lzss_encoder *z, const uint8_t *in, int len, uint8_t *out)
+{
+    int pos, end, cand, best, max, flag, bit, o, h, i, shift, dist;
+
+    if (len > LZSS_BLOCK)
+        len = LZSS_BLOCK;
+
+    memcpy(&z->buf[z->hist], in, len);
+    pos = z->hist;
+    end = z->hist + len;
+
+    out[0] = len & 0xFF;
+    out[1] = len >> 8;
+    o = 2;
+    flag = 0;
+    bit = 8;
+
+    while (pos < end)
+    {
+        if (bit == 8)
+        {
+            flag = o++;
+            out[flag] = 0;
+            bit = 0;
+        }
+
+        best = 0;
+        cand = LZSS_NONE;
+        if (end - pos >= LZSS_MIN)
+        {
+            h = lzssHash(&z->buf[pos]);
+            cand = z->head[h];
+            z->head[h] = pos;
+            if ((cand != LZSS_NONE) && (pos - cand <= LZSS_WINDOW))
+            {
+                max = end - pos;
+                if (max > LZSS_MAX)
+                    max = LZSS_MAX;
+                while ((best < max) && (z->buf[cand + best] == z->buf[pos + best]))
+                    best++;
+            }
+        }
+
+        if (best >= LZSS_MIN)
+        {
+            dist = pos - cand - 1;
+            out[flag] |= 1 << bit;
+            out[o++] = dist & 0xFF;
+            out[o++] = (dist >> 8) | ((best - LZSS_MIN) << 2);
+            for (i = pos + 1; (i < pos + best) && (end - i >= LZSS_MIN); i++)
+                z->head[lzssHash(&z->buf[i])] = i;
+            pos += best;
+        }
+        else
+        {
+            out[o++] = z->buf[pos++];
+        }
+        bit++;
+    }
+
+    // keep the last window of input as history for the next block
+    if (end > LZSS_WINDOW)
+    {
+        shift = end - LZSS_WINDOW;
+        memmove(z->buf, &z->buf[shift], LZSS_WINDOW);
+        for (i = 0; i < LZSS_HASH; i++)
+        {
+            if ((z->head[i] == LZSS_NONE) || (z->head[i] < shift))
+                z->head[i] = LZSS_NONE;
+            else
+                z->head[i] -= shift;
+        }
+        end = LZSS_WINDOW;
+    }
+    z->hist = end;
+
+    return o;
+}
+
+void lzssDecodeInit(lzss_decoder *d)
+{
+    d->pos = 0;
+}
+
+int lzssDecode(lzss_decoder *d, const uint8_t *in, int len, uint8_t *out, int *used)
+{
+    int plain, n, i, o, flag, bit, count;
+    uint32_t from;
+
+    if (len < 2)
+        return -1;
+    plain = in[0] | in[1] << 8;
+    if (plain > LZSS_BLOCK)
+        return -1;
+
+    // walk the block once to be sure it is complete before touching the history
+    i = 2;
+    n = 0;
+    bit = 8;
+    flag = 0;
+    while (n < plain)
+    {
+        if (bit == 8)
+        {
+            if (i >= len)
+                return -1;
+            flag = in[i++];
+            bit = 0;
+        }
+        if (flag & (1 << bit))
+        {
+            if (i + 2 > len)
+                return -1;
+            n += (in[i + 1] >> 2) + LZSS_MIN;
+            i += 2;
+        }
+        else
+        {
+            if (i >= len)
+                return -1;
+            n++;
+            i++;
+        }
+        bit++;
+    }
+    *used = i;
+
+    i = 2;
+    o = 0;
+    bit = 8;
+    while (o < plain)
+    {
+        if (bit == 8)
+        {
+            flag = in[i++];
+            bit = 0;
+        }
+        if (flag & (1 << bit))
+        {
+            from = d->pos - (in[i] | (in[i + 1] & 0x03) << 8) - 1;
+            count = (in[i + 1] >> 2) + LZSS_MIN;
+            i += 2;
+            while ((count-- > 0) && (o < LZSS_BLOCK))
+            {
+                out[o] = d->hist[from++ & (LZSS_WINDOW - 1)];
+                d->hist[d->pos++ & (LZSS_WINDOW - 1)] = out[o++];
+            }
+        }
+        else
+        {
+            out[o] = in[i++];
+            d->hist[d->pos++ & (LZSS_WINDOW - 1)] = out[o++];
+        }
+        bit++;
+    }
+
+    return plain;
+}
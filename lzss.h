@@ -0,0 +1,79 @@
+/**
+ * @file lzss.h
+ * @brief small window LZSS for bridge output, builds on the host as well
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdint.h>
+
+#define LZSS_WINDOW     1024    // history a match can reach back into
+#define LZSS_BLOCK      512     // most input per block
+#define LZSS_MIN        3       // shortest match worth coding
+#define LZSS_MAX        66      // longest match, 6 bits of length
+#define LZSS_HASH       512     // match candidates, one per hash
+
+/**
+ * @brief most output for a block of n bytes, a header and a flag byte per 8 literals
+ */
+#define LZSS_BOUND(n)   (2 + (n) + ((n) + 7) / 8)
+
+/*
+ * A block is a 16 bit little endian count of plain bytes followed by
+ * groups of a flag byte and 8 items, least significant flag bit first.
+ * A clear bit is a literal byte, a set bit a 2 byte match: 10 bits of
+ * distance - 1 then 6 bits of length - LZSS_MIN. History carries from
+ * block to block so every block must be decoded in order.
+ */
+
+typedef struct
+{
+    uint8_t buf[LZSS_WINDOW + LZSS_BLOCK];
+    uint16_t head[LZSS_HASH];   // last position of each hash
+    int hist;                   // bytes of history at the start of buf
+} lzss_encoder;
+
+typedef struct
+{
+    uint8_t hist[LZSS_WINDOW];
+    uint32_t pos;
+} lzss_decoder;
+
+/**
+ * @brief Start a stream
+ * @param z encoder
+ */
+void lzssInit(lzss_encoder *z);
+
+/**
+ * @brief Code a block
+ * @param z encoder
+ * @param in plain bytes
+ * @param len up to LZSS_BLOCK
+ * @param out room for LZSS_BOUND(len)
+ * @return bytes of output
+ */
+int lzssEncode(lzss_encoder *z, const uint8_t *in, int len, uint8_t *out);
+
+/**
+ * @brief Start decoding a stream
+ * @param d decoder
+ */
+void lzssDecodeInit(lzss_decoder *d);
+
+/**
+ * @brief Decode a block
+ * @param d decoder
+ * @param in start of the block
+ * @param len bytes available
+ * @param out room for LZSS_BLOCK
+ * @param used set to the length of the block
+ * @return plain bytes or -1 if the block is not all there yet
+ */
+int lzssDecode(lzss_decoder *d, const uint8_t *in, int len, uint8_t *out, int *used);
+
+#endif
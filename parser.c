@@ -7,142 +7,927 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 
+#include "ring.h"
+#include "txsched.h"
 #include "parser.h"
 #include "config.h"
 #include "cmds.h"
 #include "httpd.h"
 #include "serbridge.h"
+#include "wsserial.h"
+#include "capture.h"
+#include "scan.h"
+#include "baud.h"
 
 #define BUFFSIZE 256
 
-static const char* TAG = "parser";
+// receive buffer limits, larger buffers need PSRAM
+#define RX_BUFFER_MIN (BUFFSIZE * 2)
+#define RX_BUFFER_INTERNAL 16384
+#define RX_BUFFER_PSRAM (256 * 1024)
+
+// flow control thresholds in the 128 byte hardware fifo
+#define FLOW_RTS_THRESH 100
+#define FLOW_XOFF_THRESH 100
+#define FLOW_XON_THRESH 32
+#define BLOCKSIZE 1024
+#define UART_EVENTS 20
+#define FRAME_MAX 2048
 
-char Tokens[][10] = {"", "JOIN", "CHECK", "SET", "POLL", "PATH", "SEND", "RECV", "CLOSE", "LISTEN",
-                     "ARG", "REPLY", "CONNECT", "APSCAN", "APGET", "FINFO", "FCOUNT", "FRUN", "UDP"};
+static const char* TAG = "parser";
 
-char inBuffer[1024];
-int iHead, iTail;
 char outBuffer[1024];
 
-volatile int In, Out;
+// telnet data waiting for the uart
+static char inData[CONFIG_BRIDGE_RING_SIZE];
+static ring_t inRing = RING_INIT(inData);
+
+_Static_assert((sizeof(inData) & (sizeof(inData) - 1)) == 0, "BRIDGE_RING_SIZE must be a power of two");
+
+// websocket console input, each ring has one producer task
+static char wsData[1024];
+static ring_t wsRing = RING_INIT(wsData);
+
+static ring_t *inputs[RECEIVE_SOURCES] = { &inRing, &wsRing };
+
+// block of uart data being scanned by the parser
+static char rxBlock[BLOCKSIZE];
+static int rxHead, rxTail;
+
+// parser wakes on uart events or telnet data
+static QueueHandle_t uartQueue;
+static SemaphoreHandle_t inReady;
+static QueueSetHandle_t events;
+
+volatile int Out;
 bool parse;
+static int c;
+static char Token[10];
+static int tag;
+
+// command channel framing
+static int framing = FRAMING_TEXT;
+static int framingNext = FRAMING_TEXT;
+
+// rate the uart runs at and a change asked for by another task
+static atomic_int lineRate;
+static atomic_int baudRequest;
+
+// link errors and traffic, written only by the parser task so no lock is needed
+static uart_counters uartCounters;
+
+// passthrough escaping, a start token in data is sent twice
+static bool transparent;
+static bool escape;
+
+// binary frame being collected
+static char frameBuffer[FRAME_MAX];
+static char *frameData, *frameEnd;
+static int fState;
+static uint32_t fLen;
+static int fShift;
+static int fGot;
+static uint16_t fCrc;
+static uint16_t fRecv;
+
+enum
+{
+    FRAME_CMD,
+    FRAME_LEN,
+    FRAME_DATA,
+    FRAME_CRC1,
+    FRAME_CRC2,
+    FRAME_SKIP,
+    FRAME_BAD
+};
+
+// CRC-16/CCITT-FALSE
+static const uint16_t crcTable[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+static uint16_t crc16(uint16_t crc, const char *data, int len)
+{
+    const uint8_t *p = (const uint8_t*)data;
+
+    while (len-- > 0)
+        crc = (crc << 8) ^ crcTable[((crc >> 8) ^ *p++) & 0xff];
+
+    return crc;
+}
+
+/**
+ * @brief send a response in the current framing
+ * @param type response type
+ * @param sep separator after the type in text framing
+ * @param text response value
+ * @param data sent after the response or NULL
+ * @param len length of data
+ */
+static void respond(char type, char sep, char *text, char *data, int len)
+{
+    char Buf[200];
+    char Text[160];
+    char Crc[2];
+    tx_iov iov[3];
+    int n, t;
+    uint16_t crc;
+    uint32_t size;
+
+    t = cmdGetTag();
+
+    // header, data and trailer go out as one write
+    iov[0].base = Buf;
+    iov[1].base = data;
+    iov[1].len = len;
+    iov[2].base = Crc;
+    iov[2].len = 0;
+
+    if (framing == FRAMING_TEXT)
+    {
+        n = 0;
+        Buf[n++] = TKN_START;
+        if (t != 0)
+            n += sprintf(&Buf[n], "#%d", t);
+        t = snprintf(&Buf[n], sizeof(Buf) - n, "=%c%c%s\r", type, sep, text);
+        if (t >= sizeof(Buf) - n)
+        {
+            // cut long text but keep the terminator
+            t = sizeof(Buf) - n - 1;
+            Buf[n + t - 1] = '\r';
+        }
+        n += t;
+        iov[0].len = n;
+    }
+    else
+    {
+        if (t != 0)
+            t = snprintf(Text, sizeof(Text), "#%d,%s", t, text);
+        else
+            t = snprintf(Text, sizeof(Text), "%s", text);
+        if (t >= sizeof(Text))
+            t = sizeof(Text) - 1;
+
+        // type, varint payload length, text, NUL and data
+        size = t;
+        if (len > 0)
+            size += 1 + len;
+
+        n = 0;
+        Buf[n++] = TKN_START;
+        Buf[n++] = type;
+        do
+        {
+            Buf[n] = size & 0x7f;
+            size >>= 7;
+            if (size != 0)
+                Buf[n] |= 0x80;
+            n++;
+        } while (size != 0);
+
+        memcpy(&Buf[n], Text, t);
+        n += t;
+        if (len > 0)
+            Buf[n++] = 0;
+
+        crc = crc16(0xffff, &Buf[1], n - 1);
+        if (len > 0)
+            crc = crc16(crc, data, len);
+
+        iov[0].len = n;
+        Crc[0] = crc >> 8;
+        Crc[1] = crc & 0xff;
+        iov[2].len = 2;
+    }
+
+    txSubmit(TX_RESPONSE, iov, 3);
+}
 
 void sendResponse(char resp, int value)
 {
     char Buf[16];
-    int len;
 
-    len = sprintf(Buf, "%c=%c,%d\r", TKN_START, resp, value);
-    sendBytes(Buf, len);
+    sprintf(Buf, "%d", value);
+    respond(resp, ',', Buf, NULL, 0);
 }
 
 void sendResponseT(char* value)
 {
-    char Buf[128];
-    int len;
+    respond('S', ',', value, NULL, 0);
+}
 
-    len = sprintf(Buf, "%c=S,%s\r", TKN_START, value);
-    sendBytes(Buf, len);
+void sendResponseD(char resp, int value, char *data, int len)
+{
+    char Buf[16];
+
+    sprintf(Buf, "%d", value);
+    respond(resp, ',', Buf, data, len);
 }
 
 int sendBytes(char *Buf, int len)
 {
-    int i;
-
-    i = uart_write_bytes(UART_NUM_0, Buf, len);
-    return i;
+    return txSend(TX_RESPONSE, Buf, len);
 }
 
 int receiveBytes(char *buffer, int len)
 {
+    size_t avail;
     int i;
 
-    i = uart_read_bytes(UART_NUM_0, buffer, len, 200 / portTICK_PERIOD_MS);
+    // a binary frame carries its own data
+    if (framing == FRAMING_BINARY)
+    {
+        if (frameData >= frameEnd)
+            return -1;
+        i = frameEnd - frameData;
+        if (i > len)
+            i = len;
+        memcpy(buffer, frameData, i);
+        frameData += i;
+        return i;
+    }
+
+    // hand out what the parser already pulled from the uart first
+    i = rxTail - rxHead;
+    if (i > 0)
+    {
+        if (i > len)
+            i = len;
+        memcpy(buffer, &rxBlock[rxHead], i);
+        rxHead += i;
+        return i;
+    }
+
+    // wait for the first byte only, then take whatever else has arrived
+    i = uart_read_bytes(UART_NUM_0, buffer, 1, 200 / portTICK_PERIOD_MS);
+    if ((i == 1) && (len > 1))
+    {
+        uart_get_buffered_data_len(UART_NUM_0, &avail);
+        if (avail > len - 1)
+            avail = len - 1;
+        if (avail > 0)
+            i += uart_read_bytes(UART_NUM_0, buffer + 1, avail, 0);
+    }
+    if (i > 0)
+    {
+        uartCounters.rxBytes += i;
+        captureWrite(CAPTURE_RX, buffer, i);
+    }
 
     return i;
 }
 
 void sendResponseP(char type, int handle, int id)
 {
-    char Buf[128];
+    char Buf[32];
+
+    sprintf(Buf, "%d,%d", handle, id);
+    respond(type, ':', Buf, NULL, 0);
+}
+
+ring_t *receiveRing(int source)
+{
+    return inputs[source];
+}
+
+void doCmd()
+{
+    cmdSubmit(tag, &outBuffer[1]);
+    tag = 0;
+
+    // a framing change takes effect after its own response
+    framing = framingNext;
+}
+
+int parserFraming()
+{
+    return framingNext;
+}
+
+bool parserTransparent(void)
+{
+    return transparent;
+}
+
+void parserSetTransparent(bool enable)
+{
+    transparent = enable;
+    if (!enable)
+        escape = false;
+}
+
+static void baudSetRate(int rate)
+{
+    uart_set_baudrate(UART_NUM_0, rate);
+}
+
+static int baudRead(uint8_t *buf, int len, int ms)
+{
+    return uart_read_bytes(UART_NUM_0, buf, len, pdMS_TO_TICKS(ms));
+}
+
+static void baudWrite(const uint8_t *buf, int len)
+{
+    txSend(TX_RESPONSE, buf, len);
+    txFlush();
+}
+
+static void baudFlush(void)
+{
+    uart_flush_input(UART_NUM_0);
+}
+
+static const baud_link baudLink = { baudSetRate, baudRead, baudWrite, baudFlush };
+
+int parserNegotiateBaud(int rate)
+{
+    uint32_t actual;
+    int from;
+
+    if (!baudValid(rate))
+    {
+        sendResponse('E', ERROR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    // acknowledge at the old rate, then both sides switch
+    from = atomic_load(&lineRate);
+    sendResponse('S', rate);
+    txFlush();
+    rxHead = rxTail;
+
+    if (baudSwitch(&baudLink, from, rate) != 0)
+    {
+        ESP_LOGW(TAG, "Baud rate %d not confirmed, back to %d", rate, from);
+        return -1;
+    }
+
+    atomic_store(&lineRate, rate);
+    uart_get_baudrate(UART_NUM_0, &actual);
+    ESP_LOGI(TAG, "Baud rate %d (actual %u)", rate, (unsigned)actual);
+    return 0;
+}
+
+int parserRequestBaud(int rate)
+{
+    if (rate < BAUD_MIN)
+        rate = BAUD_MIN;
+    if (rate > BAUD_MAX)
+        rate = BAUD_MAX;
+
+    atomic_store(&baudRequest, rate);
+    xSemaphoreGive(inReady);
+    return rate;
+}
+
+void parserSetBaud(int rate)
+{
+    txFlush();
+    uart_set_baudrate(UART_NUM_0, rate);
+    atomic_store(&lineRate, rate);
+}
+
+int parserBaudRate(void)
+{
+    return atomic_load(&lineRate);
+}
+
+int parserSetFraming(int mode)
+{
+    if ((mode != FRAMING_TEXT) && (mode != FRAMING_BINARY))
+        return -1;
+
+    framingNext = mode;
+    return 0;
+}
+
+/**
+ * @brief read everything the uart driver has into the scan block
+ * @return number of bytes read
+ */
+static int fillBlock(void)
+{
+    size_t avail;
     int len;
 
-    len = sprintf(Buf, "%c=%c:%d,%d\r", TKN_START, type, handle, id);
-    sendBytes(Buf, len);
+    rxHead = 0;
+    rxTail = 0;
+
+    uart_get_buffered_data_len(UART_NUM_0, &avail);
+    if (avail == 0)
+        return 0;
+    if (avail > sizeof(rxBlock))
+        avail = sizeof(rxBlock);
+
+    len = uart_read_bytes(UART_NUM_0, rxBlock, avail, 0);
+    if (len > 0)
+    {
+        rxTail = len;
+        uartCounters.rxBytes += len;
+        captureWrite(CAPTURE_RX, rxBlock, len);
+    }
+
+    return len;
 }
 
-void receive(char* data, int len)
+/**
+ * @brief run one command byte through the token parser
+ * @param data byte from the uart
+ */
+static void parseByte(char data)
 {
-    while (In > 0)
-        Delay(200);
+    if (data == '\r')
+    {
+        doCmd();
+        Out = 0;
+        outBuffer[Out] = 0;
+        parse = false;
+        return;
+    }
+
+    // a new start token abandons the partial command
+    if ((uint8_t)data == TKN_START)
+    {
+        c = 0;
+        tag = 0;
+        Out = 0;
+        outBuffer[Out++] = TKN_START;
+        outBuffer[Out] = 0;
+        return;
+    }
 
-    memcpy(inBuffer, data, len);
-    In = len;
+    // #id ahead of the token tags the command for pipelining
+    if (c == -2)
+    {
+        if ((data >= '0') && (data <= '9'))
+        {
+            tag = tag * 10 + data - '0';
+            return;
+        }
+        c = 0;
+        if (data == ',')
+            return;
+    }
+
+    if ((c == 0) && (Out == 1) && (data == '#'))
+    {
+        c = -2;
+        tag = 0;
+        return;
+    }
+
+    if (c == 0)
+    {
+        if ((uint8_t)data > MIN_TOKEN)
+            c = -1;
+    }
+
+    if (c >= 0)
+    {
+        if (data == ':')
+        {
+            data = doTrans(Token);
+            ESP_LOGI(TAG, "Token is:%x", data);
+            c = -1;
+        }
+        else
+        {
+            Token[c++] = data;
+            Token[c] = 0;
+            if (c > 8)
+                c = -1;
+            return;
+        }
+    }
+
+    if (Out < sizeof(outBuffer) - 1)
+    {
+        outBuffer[Out++] = data;
+        outBuffer[Out] = 0;
+    }
 }
 
-void doCmd()
+/**
+ * @brief run a complete binary frame as a command
+ */
+static void frameCmd(void)
 {
-    char* parms;
+    char *s, *e;
+    int n;
 
-    parms = &outBuffer[1];
+    // payload is the argument text, then optionally a NUL and data
+    e = memchr(frameBuffer, 0, fLen);
+    if (e == NULL)
+    {
+        n = fLen;
+        frameData = &frameBuffer[fLen];
+    }
+    else
+    {
+        n = e - frameBuffer;
+        frameData = e + 1;
+    }
+    frameEnd = &frameBuffer[fLen];
 
-    switch (parms[0])
+    s = frameBuffer;
+    tag = 0;
+    if ((n > 0) && (*s == '#'))
     {
-    case 0:
-        doNothing(parms);
-        break;
-    case TKN_JOIN:
-        doJoin(parms);
-        break;
-    case TKN_SEND:
-        doSend(parms);
-        break;
-    case TKN_RECV:
-        doRecv(parms);
-        break;
-    case TKN_CONNECT:
-        doConnect(parms);
+        s++;
+        n--;
+        while ((n > 0) && (*s >= '0') && (*s <= '9'))
+        {
+            tag = tag * 10 + *s++ - '0';
+            n--;
+        }
+        if ((n > 0) && (*s == ','))
+        {
+            s++;
+            n--;
+        }
+    }
+
+    if (n > sizeof(outBuffer) - 3)
+        n = sizeof(outBuffer) - 3;
+    memcpy(&outBuffer[2], s, n);
+    Out = 2 + n;
+    outBuffer[Out] = 0;
+
+    doCmd();
+
+    frameData = NULL;
+    frameEnd = NULL;
+    Out = 0;
+}
+
+/**
+ * @brief collect a binary frame from the scan block
+ */
+static void parseFrame(void)
+{
+    char data;
+    int len;
+
+    while ((rxHead < rxTail) && parse)
+    {
+        switch (fState)
+        {
+        case FRAME_CMD:
+            data = rxBlock[rxHead++];
+            fCrc = crc16(fCrc, &data, 1);
+            outBuffer[0] = TKN_START;
+            outBuffer[1] = data;
+            Out = 2;
+            fState = FRAME_LEN;
+            break;
+        case FRAME_LEN:
+            data = rxBlock[rxHead++];
+            fCrc = crc16(fCrc, &data, 1);
+            fLen |= (uint32_t)(data & 0x7f) << fShift;
+            fShift += 7;
+            if ((data & 0x80) != 0)
+            {
+                if (fShift > 21)
+                    fState = FRAME_BAD;
+                break;
+            }
+            if (fLen > sizeof(frameBuffer))
+            {
+                // step over the payload and crc so they are not taken as data
+                fLen += 2;
+                fState = FRAME_SKIP;
+            }
+            else if (fLen == 0)
+                fState = FRAME_CRC1;
+            else
+                fState = FRAME_DATA;
+            break;
+        case FRAME_DATA:
+            len = rxTail - rxHead;
+            if (len > fLen - fGot)
+                len = fLen - fGot;
+            memcpy(&frameBuffer[fGot], &rxBlock[rxHead], len);
+            fCrc = crc16(fCrc, &rxBlock[rxHead], len);
+            rxHead += len;
+            fGot += len;
+            if (fGot == fLen)
+                fState = FRAME_CRC1;
+            break;
+        case FRAME_CRC1:
+            fRecv = (uint8_t)rxBlock[rxHead++] << 8;
+            fState = FRAME_CRC2;
+            break;
+        case FRAME_CRC2:
+            fRecv |= (uint8_t)rxBlock[rxHead++];
+            parse = false;
+            if (fRecv != fCrc)
+            {
+                ESP_LOGW(TAG, "Frame crc %04x expected %04x", fRecv, fCrc);
+                sendResponse('E', ERROR_INVALID_REQUEST);
+                break;
+            }
+            frameCmd();
+            break;
+        case FRAME_SKIP:
+            len = rxTail - rxHead;
+            if (len > fLen - fGot)
+                len = fLen - fGot;
+            rxHead += len;
+            fGot += len;
+            if (fGot < fLen)
+                break;
+            ESP_LOGW(TAG, "Frame too large");
+            parse = false;
+            Out = 0;
+            sendResponse('E', ERROR_INVALID_SIZE);
+            break;
+        default:
+            // the length itself is bad, look for the next start
+            ESP_LOGW(TAG, "Frame length invalid");
+            parse = false;
+            Out = 0;
+            sendResponse('E', ERROR_INVALID_SIZE);
+        }
+    }
+}
+
+/**
+ * @brief reset the parsers for a new command
+ */
+static void startCommand(void)
+{
+    uartCounters.modeSwitches++;
+    parse = true;
+    c = 0;
+    tag = 0;
+    Out = 0;
+    outBuffer[Out++] = TKN_START;
+    outBuffer[Out] = 0;
+    fState = FRAME_CMD;
+    fLen = 0;
+    fShift = 0;
+    fGot = 0;
+    fCrc = 0xffff;
+}
+
+/**
+ * @brief pass data through and parse commands in the scan block
+ */
+static void scanBlock(void)
+{
+    char *s, *p;
+    int len, skip, n;
+
+    while (rxHead < rxTail)
+    {
+        if (parse)
+        {
+            if (framing == FRAMING_BINARY)
+                parseFrame();
+            else
+                parseByte(rxBlock[rxHead++]);
+            continue;
+        }
+
+        s = &rxBlock[rxHead];
+        skip = 0;
+        if (escape)
+        {
+            escape = false;
+            if (*s != TKN_START)
+            {
+                startCommand();
+                continue;
+            }
+            // doubled start is a data byte, keep the second one in the slice
+            skip = 1;
+        }
+
+        // pass everything up to the next command through as one slice
+        p = findStart(s + skip, rxTail - rxHead - skip);
+        if (p == NULL)
+            len = rxTail - rxHead;
+        else
+            len = p - s;
+
+        if (len > 0)
+        {
+            n = serbridgeSend(s, len);
+            wsSerialSend(s, n);
+            rxHead += n;
+            if (n < len)
+            {
+                // a client is behind, leave the rest in the uart so rts holds the Propeller
+                if ((n == 0) && (skip != 0))
+                    escape = true;
+                serbridgeWait();
+                continue;
+            }
+        }
+
+        if (p != NULL)
+        {
+            rxHead++;
+            // the next byte decides, it may be in the next block
+            if (transparent)
+                escape = true;
+            else
+                startCommand();
+        }
+    }
+}
+
+/**
+ * @brief write data to the uart doubling the first start token
+ * @param s data to write
+ * @param len length of data
+ * @return bytes of data consumed or -1 if they could not be queued
+ */
+static int sendEscaped(char *s, int len)
+{
+    tx_iov iov[2];
+    char *p;
+
+    p = findStart(s, len);
+    if (p == NULL)
+        return txSend(TX_BULK, s, len);
+
+    // one write so a response cannot land between the two start tokens
+    len = p - s + 1;
+    iov[0].base = s;
+    iov[0].len = len;
+    iov[1].base = p;
+    iov[1].len = 1;
+    if (txSubmit(TX_BULK, iov, 2) < 0)
+        return -1;
+
+    return len;
+}
+
+/**
+ * @brief write queued telnet and websocket data to the uart
+ */
+static void drainRing(void)
+{
+    char *s;
+    int len, i;
+
+    for (i = 0; i < RECEIVE_SOURCES; i++)
+    {
+        len = ringPeek(inputs[i], &s);
+        while (len > 0)
+        {
+            if (len > BLOCKSIZE)
+                len = BLOCKSIZE;
+            if (transparent)
+                len = sendEscaped(s, len);
+            else
+                len = txSend(TX_BULK, s, len);
+
+            // data that could not be queued stays in the ring for the next pass
+            if (len < 0)
+                break;
+            uartCounters.txBytes += len;
+            ringConsume(inputs[i], len);
+            len = ringPeek(inputs[i], &s);
+        }
+    }
+}
+
+/**
+ * @brief handle a uart driver event
+ * @param event from the driver queue
+ */
+static void uartEvent(uart_event_t *event)
+{
+    switch (event->type)
+    {
+    case UART_DATA:
+    case UART_PATTERN_DET:
         break;
-    case TKN_CLOSE:
-        doClose(parms);
+    case UART_FIFO_OVF:
+        uartCounters.fifoOverflow++;
+        ESP_LOGW(TAG, "Uart fifo overflow");
         break;
-    case TKN_CHECK:
-        doGet(parms);
+    case UART_BUFFER_FULL:
+        uartCounters.bufferFull++;
+        ESP_LOGW(TAG, "Uart buffer full");
         break;
-    case TKN_SET:
-        doSet(parms);
+    case UART_FRAME_ERR:
+        uartCounters.frameErrors++;
         break;
-    case TKN_LISTEN:
-        doListen(parms);
+    case UART_PARITY_ERR:
+        uartCounters.parityErrors++;
         break;
-    case TKN_REPLY:
-        doReply(parms);
+    default:
+        ESP_LOGI(TAG, "Uart event: %d", event->type);
+    }
+}
+
+/**
+ * @brief receive buffer size the driver can get
+ * @return bytes, the configured size clamped to the memory present
+ */
+static int rxBufferSize(void)
+{
+    int size, limit;
+
+    // the larger limit assumes malloc can place large blocks in PSRAM,
+    // when it cannot the install fails and parserInit falls back
+    limit = RX_BUFFER_INTERNAL;
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0)
+        limit = RX_BUFFER_PSRAM;
+
+    size = flashConfig.rx_buffer;
+    if (size < RX_BUFFER_MIN)
+        size = RX_BUFFER_MIN;
+    if (size > limit)
+    {
+        ESP_LOGW(TAG, "Uart buffer %d limited to %d", size, limit);
+        size = limit;
+    }
+
+    return size;
+}
+
+int parserSetFlowControl(int mode)
+{
+    switch (mode)
+    {
+    case FLOW_NONE:
+        uart_set_hw_flow_ctrl(UART_NUM_0, UART_HW_FLOWCTRL_DISABLE, 0);
+        uart_set_sw_flow_ctrl(UART_NUM_0, false, 0, 0);
         break;
-    case TKN_ARG:
-        doArg(parms);
+    case FLOW_RTS_CTS:
+        uart_set_sw_flow_ctrl(UART_NUM_0, false, 0, 0);
+        uart_set_pin(UART_NUM_0, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, flashConfig.rts_pin, flashConfig.cts_pin);
+        uart_set_hw_flow_ctrl(UART_NUM_0, UART_HW_FLOWCTRL_CTS_RTS, FLOW_RTS_THRESH);
         break;
-    case TKN_POLL:
-        doPoll(parms);
+    case FLOW_XON_XOFF:
+        uart_set_hw_flow_ctrl(UART_NUM_0, UART_HW_FLOWCTRL_DISABLE, 0);
+        uart_set_sw_flow_ctrl(UART_NUM_0, true, FLOW_XON_THRESH, FLOW_XOFF_THRESH);
         break;
-    default :
-        printf("*Nothing*\n");
+    default:
+        return -1;
     }
+
+    return 0;
+}
+
+void parserUartCounters(uart_counters *counters)
+{
+    *counters = uartCounters;
 }
 
 void parserInit()
 {
-    int len;
-    int c;
-    char Token[10];
+    QueueSetMemberHandle_t member;
+    uart_event_t event;
+    int size, rate;
 
-    memset(inBuffer, 0, sizeof(inBuffer));
     memset(outBuffer, 0, sizeof(outBuffer));
+    cmdInit();
 
     uart_config_t uart_config =
     {
@@ -154,97 +939,82 @@ void parserInit()
         .source_clk = UART_SCLK_APB,
     };
 
-    c = uart_driver_install(UART_NUM_0, BUFFSIZE * 2, 0, 0, NULL, 0);
+    size = rxBufferSize();
+    if (uart_driver_install(UART_NUM_0, size, 0, UART_EVENTS, &uartQueue, 0) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Uart buffer %d not available, using %d", size, RX_BUFFER_MIN);
+        size = RX_BUFFER_MIN;
+        ESP_ERROR_CHECK(uart_driver_install(UART_NUM_0, size, 0, UART_EVENTS, &uartQueue, 0));
+    }
     uart_param_config(UART_NUM_0, &uart_config);
+    atomic_store(&lineRate, flashConfig.baud_rate);
     uart_set_pin(UART_NUM_0, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    uart_set_rx_timeout(UART_NUM_0, 3);
+    if (parserSetFlowControl(flashConfig.flow_ctrl) != 0)
+        ESP_LOGW(TAG, "Unknown flow control %d", flashConfig.flow_ctrl);
+    ESP_LOGI(TAG, "Uart buffer %d flow control %d", size, flashConfig.flow_ctrl);
+    txInit(UART_NUM_0);
+    captureInit();
+
+    // wake as soon as a command line is complete
+    uart_enable_pattern_det_baud_intr(UART_NUM_0, '\r', 1, 9, 0, 0);
+    uart_pattern_queue_reset(UART_NUM_0, UART_EVENTS);
+
+    inReady = xSemaphoreCreateBinary();
+    events = xQueueCreateSet(UART_EVENTS + 1);
+    xQueueAddToSet(uartQueue, events);
+    xQueueAddToSet(inReady, events);
+    inRing.ready = inReady;
+    wsRing.ready = inReady;
 
-    // Configure a buffer for the incoming data
-    char data; // = (uint8_t*)malloc(BUFFSIZE);
-
-    In = 0;
     Out = 0;
     parse = false;
     c = -1;
+    rxHead = 0;
+    rxTail = 0;
 
     ESP_LOGI(TAG, "Uart Configured");
     Delay(1000);
 
     while (true)
     {
-        len = receiveBytes(&data, 1);
+        member = xQueueSelectFromSet(events, portMAX_DELAY);
 
-        if (len > 0)
+        if (member == uartQueue)
         {
-            if (parse)
-            {
-                if (data == '\r')
-                {
-                    doCmd();
-                    Out = 0;
-                    outBuffer[Out] = 0;
-                    parse = false;
-                    continue;
-                }
-            }
-
-            if (c == 0)
-            {
-                if (data > MIN_TOKEN)
-                    c = -1;
-            }
-
-            if (c >= 0)
-            {
-                if (data == ':')
-                {
-                    data = doTrans(Token);
-                    ESP_LOGI(TAG, "Token is:%x", data);
-                    c = -1;
-                }
-                else
-                {
-                    Token[c++] = data;
-                    Token[c] = 0;
-                    if (c > 8)
-                        c = -1;
-                    continue;
-                }
-            }
-
-            if (data == TKN_START)
-            {
-                parse = true;
-                c = 0;
-            }
-
-            if (Out < 1024)
-            {
-                outBuffer[Out++] = data;
-                outBuffer[Out] = 0;
-            }
+            xQueueReceive(uartQueue, &event, 0);
+            uartEvent(&event);
+        }
+        else if (member == inReady)
+        {
+            xSemaphoreTake(inReady, 0);
         }
 
-        if ((Out > 0) && (parse == false))
+        // a rate change from a bridge client waits for running commands like BAUD
+        rate = atomic_exchange(&baudRequest, 0);
+        if (rate != 0)
         {
-            serbridgeSend(outBuffer, Out);
-            Out = 0;
+            cmdWaitAll();
+            parserSetBaud(rate);
+            ESP_LOGI(TAG, "Baud rate %d for this session", rate);
         }
 
-        if (In > 0)
+        while (fillBlock() > 0)
         {
-            sendBytes(inBuffer, In);
-            In = 0;
+            scanBlock();
+            drainRing();
         }
+
+        drainRing();
     }
 }
 
 char doTrans(char *T)
 {
-    int i;
+    cmd_entry *cmd;
 
-    for (i=0;i<19;i++)
-        if (strcmp(Tokens[i], T) == 0)
-            return 0xf0 - i;
-    return ' ';
+    cmd = cmdFindName(T);
+    if (cmd == NULL)
+        return ' ';
+    return cmd->token;
 }
-
@@ -5,6 +5,33 @@
  * @version 1.0
  */
 
+#include <stdbool.h>
+#include "ring.h"
+
+typedef struct
+{
+    uint32_t fifoOverflow;      // hardware fifo overran, bytes lost
+    uint32_t bufferFull;        // driver buffer filled, bytes lost
+    uint32_t frameErrors;
+    uint32_t parityErrors;
+    uint32_t rxBytes;           // read from the uart
+    uint32_t txBytes;           // network data written to the uart
+    uint32_t modeSwitches;      // passthrough to command
+} uart_counters;
+
+/*
+ * Command channel framing. Binary frames are
+ * <start><command><varint length><payload><crc16>, where the payload is the
+ * argument text optionally followed by a NUL and data, and the crc is
+ * CRC-16/CCITT-FALSE over everything after the start byte. Responses use
+ * the same layout with the response type as the command byte.
+ */
+enum
+{
+    FRAMING_TEXT = 0,
+    FRAMING_BINARY = 1
+};
+
 /**
  * @brief Startup command parser
  * 
@@ -18,6 +45,15 @@ void parserInit(void);
  */
 void sendResponse(char, int);
 
+/**
+ * @brief Send Response followed by its data
+ * @param Resp character
+ * @param value of response
+ * @param data to send after the response
+ * @param len length of data
+ */
+void sendResponseD(char, int, char*, int);
+
 /**
  * @brief Send Response text
  * @param value to send
@@ -44,16 +80,94 @@ int sendBytes(char *Buf, int len);
  * @brief Receive Serial Bytes
  * @param buffer for data to receive
  * @param len length of data to receive
- * @return status number of bytes or error
+ * @return bytes received, as soon as any arrive, or error
 */
 int receiveBytes(char *buffer, int len);
 
+// producers of uart input, one task each
+enum
+{
+    RECEIVE_TELNET = 0,
+    RECEIVE_WS = 1,
+    RECEIVE_SOURCES
+};
+
 /**
- * @brief Receive data from telnet
- * @param data character data
- * @param len length of data
+ * @brief Ring carrying client data to the uart
+ * @param source RECEIVE_TELNET or RECEIVE_WS
+ * @return ring the source fills and the parser drains
+ */
+ring_t *receiveRing(int source);
+
+/**
+ * @brief Current command channel framing
+ * @return FRAMING_TEXT or FRAMING_BINARY
+ */
+int parserFraming(void);
+
+/**
+ * @brief Switch framing once the current command has responded
+ * @param mode FRAMING_TEXT or FRAMING_BINARY
+ * @return 0 or -1 if mode is invalid
+ */
+int parserSetFraming(int mode);
+
+/**
+ * @brief Passthrough escaping state
+ * @return true if a start token in data is sent doubled
+ */
+bool parserTransparent(void);
+
+/**
+ * @brief Enable passthrough escaping, data from the Propeller must double
+ * its start tokens and start tokens in data to the Propeller are doubled
+ * @param enable transparent mode
+ */
+void parserSetTransparent(bool enable);
+
+/**
+ * @brief Switch the uart to a faster rate agreed with the Propeller.
+ * Acknowledges at the current rate, then runs the probe, echo and confirm
+ * exchange in baud.h. Without all of it the uart returns to the rate it
+ * had before.
+ * @param rate proposed baud rate
+ * @return 0 or -1 if the rate was refused or the probe failed
+ */
+int parserNegotiateBaud(int rate);
+
+/**
+ * @brief Change the uart rate for this session only, from any task.
+ * The parser task applies it once every lane is idle, the configured
+ * rate is left alone.
+ * @param rate requested
+ * @return rate that will be applied, clamped to the supported range
+ */
+int parserRequestBaud(int rate);
+
+/**
+ * @brief Set the uart rate now, after queued output has gone
+ * @param rate new rate
+ */
+void parserSetBaud(int rate);
+
+/**
+ * @brief Rate the uart runs at
+ * @return baud rate
+ */
+int parserBaudRate(void);
+
+/**
+ * @brief Apply a flow control mode to the uart
+ * @param mode FLOW_NONE, FLOW_RTS_CTS or FLOW_XON_XOFF
+ * @return 0 or -1 if mode is invalid
+ */
+int parserSetFlowControl(int mode);
+
+/**
+ * @brief Copy the uart error counters
+ * @param counters filled in
  */
-void receive(char*, int);
+void parserUartCounters(uart_counters *counters);
 
 /**
  * @brief Translate Text to token
@@ -0,0 +1,121 @@
+/**
+ * @file ring.c
+ * @brief single producer single consumer byte ring
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <string.h>
+#include "ring.h"
+
+
+int ringUsed(ring_t *r)
+{
+    return atomic_load_explicit(&r->head, memory_order_acquire) - atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+int ringFree(ring_t *r)
+{
+    return r->size - ringUsed(r);
+}
+
+int ringWriteSpace(ring_t *r, char **data)
+{
+    uint32_t head, tail;
+    uint32_t offset;
+    uint32_t len;
+
+    head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    offset = head & (r->size - 1);
+
+    len = r->size - (head - tail);
+    if (len > r->size - offset)
+        len = r->size - offset;
+
+    *data = &r->buf[offset];
+    return len;
+}
+
+void ringCommit(ring_t *r, int len)
+{
+    uint32_t head, used;
+
+    head = atomic_load_explicit(&r->head, memory_order_relaxed) + len;
+    atomic_store_explicit(&r->head, head, memory_order_release);
+
+    used = head - atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (used > r->high)
+        r->high = used;
+
+    if (r->ready != NULL)
+        xSemaphoreGive(r->ready);
+}
+
+int ringWrite(ring_t *r, const char *data, int len)
+{
+    char *p;
+    int i, t;
+
+    t = 0;
+    while (t < len)
+    {
+        i = ringWriteSpace(r, &p);
+        if (i == 0)
+            break;
+        if (i > len - t)
+            i = len - t;
+        memcpy(p, &data[t], i);
+        ringCommit(r, i);
+        t += i;
+    }
+
+    return t;
+}
+
+int ringPeek(ring_t *r, char **data)
+{
+    uint32_t head, tail;
+    uint32_t offset;
+    uint32_t len;
+
+    head = atomic_load_explicit(&r->head, memory_order_acquire);
+    tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    offset = tail & (r->size - 1);
+
+    len = head - tail;
+    if (len > r->size - offset)
+        len = r->size - offset;
+
+    *data = &r->buf[offset];
+    return len;
+}
+
+void ringConsume(ring_t *r, int len)
+{
+    atomic_fetch_add(&r->tail, len);
+
+    // pairs with ringStall so a stalled producer is never missed
+    if (atomic_load(&r->full) && atomic_exchange(&r->full, false) && (r->space != NULL))
+        r->space(r->spaceArg);
+}
+
+bool ringStall(ring_t *r)
+{
+    bool stalled;
+
+    stalled = atomic_exchange(&r->full, true);
+
+    if (atomic_load(&r->head) - atomic_load(&r->tail) < r->size)
+    {
+        atomic_store(&r->full, false);
+        return false;
+    }
+
+    // a producer that keeps finding the ring full counts once per stall
+    if (!stalled)
+        r->stalls++;
+
+    return true;
+}
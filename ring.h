@@ -0,0 +1,97 @@
+/**
+ * @file ring.h
+ * @brief single producer single consumer byte ring
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+typedef struct
+{
+    char *buf;
+    uint32_t size;                  // power of two
+    atomic_uint head;               // bytes written, producer only
+    atomic_uint tail;               // bytes read, consumer only
+    SemaphoreHandle_t ready;        // given when data is committed
+    void (*space)(void *arg);       // called by the consumer when a stalled producer has room
+    void *spaceArg;
+    atomic_bool full;               // producer stalled, set by ringStall
+    uint32_t high;                  // high water mark
+    uint32_t stalls;                // times the producer found the ring full, producer only
+} ring_t;
+
+/**
+ * @brief static initializer for a ring over a power of two array
+ */
+#define RING_INIT(b) { .buf = (b), .size = sizeof(b) }
+
+/**
+ * @brief Bytes waiting in the ring
+ * @param r ring
+ * @return occupancy
+ */
+int ringUsed(ring_t *r);
+
+/**
+ * @brief Bytes that can still be written
+ * @param r ring
+ * @return free space
+ */
+int ringFree(ring_t *r);
+
+/**
+ * @brief Contiguous space the producer can fill in place
+ * @param r ring
+ * @param data returns pointer to space
+ * @return length of space
+ */
+int ringWriteSpace(ring_t *r, char **data);
+
+/**
+ * @brief Publish bytes filled in place and signal the consumer
+ * @param r ring
+ * @param len number of bytes written
+ */
+void ringCommit(ring_t *r, int len);
+
+/**
+ * @brief Copy data into the ring
+ * @param r ring
+ * @param data data to write
+ * @param len length of data
+ * @return number of bytes written
+ */
+int ringWrite(ring_t *r, const char *data, int len);
+
+/**
+ * @brief Contiguous data the consumer can read in place
+ * @param r ring
+ * @param data returns pointer to data
+ * @return length of data
+ */
+int ringPeek(ring_t *r, char **data);
+
+/**
+ * @brief Release bytes read in place
+ * @param r ring
+ * @param len number of bytes read
+ */
+void ringConsume(ring_t *r, int len);
+
+/**
+ * @brief Ask for the space callback once the consumer frees room
+ * @param r ring the producer found full
+ * @return true if still full, false if room appeared meanwhile
+ */
+bool ringStall(ring_t *r);
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file scan.c
+ * @brief find command starts in uart data, builds on the host as well
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "cmds.h"
+#include "scan.h"
+
+
+char *findStart(char *buf, int len)
+{
+    const uint32_t ones = 0x01010101;
+    const uint32_t highs = 0x80808080;
+    const uint32_t pattern = ones * TKN_START;
+    uint8_t *p = (uint8_t*)buf;
+    uint8_t *e = p + len;
+    uint32_t w;
+
+    while ((p < e) && (((uintptr_t)p & 3) != 0))
+    {
+        if (*p == TKN_START)
+            return (char*)p;
+        p++;
+    }
+
+    // a zero byte in w marks a start token somewhere in the word
+    while (p + 4 <= e)
+    {
+        memcpy(&w, p, 4);
+        w = w ^ pattern;
+        if (((w - ones) & ~w & highs) != 0)
+            break;
+        p += 4;
+    }
+
+    while (p < e)
+    {
+        if (*p == TKN_START)
+            return (char*)p;
+        p++;
+    }
+
+    return NULL;
+}
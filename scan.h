@@ -0,0 +1,20 @@
+/**
+ * @file scan.h
+ * @brief find command starts in uart data, builds on the host as well
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+/**
+ * @brief Find the next command start a word at a time
+ * @param buf data to scan
+ * @param len length of data
+ * @return pointer to start token or NULL
+ */
+char *findStart(char *buf, int len);
+
+#endif
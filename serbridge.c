@@ -3,51 +3,1468 @@
 #include "lwip/sockets.h"
 #include "lwip/sys.h"
 #include <lwip/netdb.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_vfs_eventfd.h"
+#include "esp_heap_caps.h"
+#include "esp_wifi.h"
+#include "driver/uart.h"
 #include "serbridge.h"
 #include "config.h"
+#include "settings.h"
+#include "status.h"
+#include "ring.h"
 #include "parser.h"
+#include "lzss.h"
 
 
 static const char* TAG = "serbridge";
 static int _PORT;
-int currentSocket;
 
-static void doTerminal()
+// arrival of queued output, up to queue position end
+#define BRIDGE_MARKS 8
+
+typedef struct
 {
-  int len;
-  char rx_buffer[1024];
+  uint32_t end;
+  int64_t time;
+} bridge_mark;
+
+typedef struct
+{
+  int sock;
+  char addr[16];
+  int64_t last;       // time of the last input in us
+  int64_t stamp;      // when the oldest unsent output arrived
+  int64_t connected;  // accept time, the oldest client goes on takeover
+  int64_t active;     // last input or output that got through
+  ring_t queue;       // uart output waiting for the socket
+  char *out;          // output taken from the queue, select loop only
+  int outLen, outPos;
+  uint32_t outBase;   // queue position of out[0]
+  bridge_mark marks[BRIDGE_MARKS];  // oldest first
+  uint8_t markCount;
+  bool kill;          // fell behind under BRIDGE_DISCONNECT
+  bool due;           // flush whatever is queued, set by newline or timer
+  int8_t mode;        // coalescing mode applied to the socket
+  bool checked;       // first input seen
+  bool telnet;        // client speaks telnet, 0xFF is escaped both ways
+  bool iacOut;        // owes the client the second byte of an escaped 0xFF
+  bool suspended;     // FLOWCONTROL-SUSPEND from the client
+  uint8_t tState;     // telnet input state
+  uint8_t tVerb;      // WILL, WONT, DO or DONT being parsed
+  uint8_t dtr, rts;   // last SET-CONTROL values
+  uint8_t sbLen;
+  uint8_t sb[16];     // subnegotiation being collected
+  lzss_encoder *lz;   // output is compressed once negotiated
+  uint8_t *lzOut;     // coded blocks waiting for the socket
+  int lzLen, lzPos;
+} bridge_client;
+
+// telnet commands and options
+#define IAC   255
+#define DONT  254
+#define DO    253
+#define WONT  252
+#define WILL  251
+#define SB    250
+#define SE    240
+#define OPT_BINARY    0
+#define OPT_ECHO      1
+#define OPT_SGA       3
+#define OPT_COMPORT   44
+#define OPT_LZSS      140   // private, everything after IAC SB OPT_LZSS IAC SE is lzss blocks
+
+// a block of output plus a reply queued behind it
+#define LZ_OUT        (LZSS_BOUND(LZSS_BLOCK) + LZSS_BOUND(32))
+
+// RFC 2217 client to server commands, the server answers with cmd + 100
+#define CPC_SIGNATURE       0
+#define CPC_SET_BAUDRATE    1
+#define CPC_SET_DATASIZE    2
+#define CPC_SET_PARITY      3
+#define CPC_SET_STOPSIZE    4
+#define CPC_SET_CONTROL     5
+#define CPC_FLOW_SUSPEND    8
+#define CPC_FLOW_RESUME     9
+#define CPC_PURGE_DATA      12
+#define CPC_REPLY           100
+
+enum
+{
+  TS_DATA,
+  TS_IAC,
+  TS_OPT,
+  TS_SB,
+  TS_SB_IAC
+};
+
+// the lock covers the client table and the queue contents, never a
+// client's socket calls or compression, so one slow client holds up nobody
+static bridge_client Clients[BRIDGE_MAX];
+static SemaphoreHandle_t clientLock;
+
+// wakes the select loop when a queue goes from empty to not empty
+static int wakeFd = -1;
+
+// given as queues drain, for a parser waiting under BRIDGE_BACKPRESSURE
+static SemaphoreHandle_t bridgeSpace;
+
+// ends a batch that never reached bridge_batch bytes or a newline
+static esp_timer_handle_t flushTimer;
+
+// recent uart output for late joiners, a power of two, written under the lock
+static char *scrollBuf;
+static uint32_t scrollSize;
+static uint32_t scrollTotal;
+
+// udp bridge, the frame being built goes out as one datagram
+static int udpSock = -1;
+static struct sockaddr_in udpPeer;
+static bool udpHavePeer;
+static char udpFrame[BRIDGE_UDP_MAX];
+static int udpFill;
+static SemaphoreHandle_t udpLock;
+static esp_timer_handle_t udpTimer;
+static uint32_t udpFrames;
+static uint32_t udpLost;
+
+// counters, each written by one task and where it already holds the lock
+static uint32_t bridgeDropped;
+static uint32_t bridgeKilled;
+static uint32_t bridgeConnects;
+static uint32_t bridgeCloses;
+static uint32_t bridgeIn;
+static uint32_t bridgeOut;
+static uint32_t bridgeLatency[BRIDGE_LATENCY_BUCKETS];
+
+// compression totals for the ratio and cost
+static uint32_t lzIn;
+static uint32_t lzOutTotal;
+static uint32_t lzTime;
+
+// client holding the uart under BRIDGE_MERGE_ONE
+static int writer = -1;
+
+static int bridgeLimit(void)
+{
+  if (flashConfig.bridge_clients < 1)
+    return 1;
+  if (flashConfig.bridge_clients > BRIDGE_MAX)
+    return BRIDGE_MAX;
+  return flashConfig.bridge_clients;
+}
+
+static int bridgeBatch(void)
+{
+  if (flashConfig.bridge_batch < 1)
+    return 1;
+  if (flashConfig.bridge_batch > BRIDGE_QUEUE / 2)
+    return BRIDGE_QUEUE / 2;
+  return flashConfig.bridge_batch;
+}
+
+/**
+ * @brief whether a client's queue should be sent now
+ * @param i client
+ * @return true to send
+ */
+static bool bridgeQueued(int i)
+{
+  int used;
+
+  used = ringUsed(&Clients[i].queue);
+  if (used == 0)
+    return false;
+  if (flashConfig.bridge_mode == BRIDGE_INTERACTIVE)
+    return true;
+  return Clients[i].due || (used >= bridgeBatch());
+}
+
+/**
+ * @brief whether output taken from the queue is still unsent, select loop only
+ * @param c client
+ * @return true if some is left
+ */
+static bool bridgeStaged(bridge_client *c)
+{
+  return c->iacOut || (c->outPos < c->outLen) || ((c->lz != NULL) && (c->lzPos < c->lzLen));
+}
+
+/**
+ * @brief whether a client has output to send now, select loop only
+ * @param i client
+ * @return true to send
+ */
+static bool bridgeReady(int i)
+{
+  return bridgeStaged(&Clients[i]) || bridgeQueued(i);
+}
+
+/**
+ * @brief Nagle only stays on when the bridge is batching anyway
+ * @param i client
+ */
+static void bridgeMode(int i)
+{
+  int flag;
+
+  Clients[i].mode = flashConfig.bridge_mode;
+  flag = Clients[i].mode == BRIDGE_INTERACTIVE;
+  setsockopt(Clients[i].sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+/**
+ * @brief start the batch timer for data waiting to be coalesced
+ */
+static void bridgeArm(void)
+{
+  if ((flashConfig.bridge_mode != BRIDGE_INTERACTIVE) && !esp_timer_is_active(flushTimer))
+    esp_timer_start_once(flushTimer, flashConfig.bridge_delay);
+}
+
+/**
+ * @brief note when output up to the queue head arrived, called with the lock held
+ * @param c client
+ * @param now current time
+ */
+static void bridgeMark(bridge_client *c, int64_t now)
+{
+  uint32_t end;
+
+  end = atomic_load(&c->queue.head);
+  if (c->markCount == 0)
+    c->stamp = now;
+
+  // out of marks, the newest stretches and its later bytes count as older
+  if (c->markCount == BRIDGE_MARKS)
+  {
+    c->marks[BRIDGE_MARKS - 1].end = end;
+    return;
+  }
+  c->marks[c->markCount].end = end;
+  c->marks[c->markCount].time = now;
+  c->markCount++;
+}
+
+/**
+ * @brief forget output before a queue position and stamp the oldest left,
+ * called with the lock held
+ * @param c client
+ * @param pos queue position of the oldest unsent byte
+ */
+static void bridgeSent(bridge_client *c, uint32_t pos)
+{
+  int n;
+
+  for (n = 0; (n < c->markCount) && ((int32_t)(c->marks[n].end - pos) <= 0); n++)
+    ;
+  memmove(c->marks, &c->marks[n], (c->markCount - n) * sizeof(bridge_mark));
+  c->markCount -= n;
+  if (c->markCount > 0)
+    c->stamp = c->marks[0].time;
+}
+
+/**
+ * @brief wake the loop when the parser frees room in the receive ring
+ * @param arg unused
+ */
+static void bridgeSpaceFree(void *arg)
+{
+  uint64_t one = 1;
+
+  write(wakeFd, &one, sizeof(one));
+}
+
+static void bridgeFlush(void *arg)
+{
+  uint64_t one = 1;
+  int i;
+
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  for (i = 0; i < BRIDGE_MAX; i++)
+  {
+    if (Clients[i].sock >= 0)
+      Clients[i].due = true;
+  }
+  xSemaphoreGive(clientLock);
+  write(wakeFd, &one, sizeof(one));
+}
+
+/**
+ * @brief record uart output in the scrollback, called with the lock held
+ * @param data output
+ * @param len length of output
+ */
+static void scrollWrite(char *data, int len)
+{
+  uint32_t offset;
+  int n;
+
+  if (scrollBuf == NULL)
+    return;
+
+  if (len > scrollSize)
+  {
+    data += len - scrollSize;
+    scrollTotal += len - scrollSize;
+    len = scrollSize;
+  }
+
+  offset = scrollTotal & (scrollSize - 1);
+  n = scrollSize - offset;
+  if (n > len)
+    n = len;
+  memcpy(&scrollBuf[offset], data, n);
+  memcpy(scrollBuf, &data[n], len - n);
+  scrollTotal += len;
+}
+
+/**
+ * @brief queue the end of the scrollback, called with the lock held
+ * @param q client queue
+ * @param len bytes wanted
+ */
+static void scrollReplay(ring_t *q, uint32_t len)
+{
+  uint32_t offset;
+  int n;
+
+  if (scrollBuf == NULL)
+    return;
+  if (len > scrollTotal)
+    len = scrollTotal;
+  if (len > scrollSize)
+    len = scrollSize;
+  if (len > q->size)
+    len = q->size;
+
+  offset = (scrollTotal - len) & (scrollSize - 1);
+  n = scrollSize - offset;
+  if (n > len)
+    n = len;
+  ringWrite(q, &scrollBuf[offset], n);
+  ringWrite(q, scrollBuf, len - n);
+}
+
+/**
+ * @brief allocate the scrollback, in PSRAM when it is large
+ */
+static void scrollInit(void)
+{
+  uint32_t size;
+
+  if (flashConfig.scrollback <= 0)
+    return;
+
+  if ((flashConfig.scrollback > BRIDGE_SCROLL_INTERNAL) && (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) == 0))
+    flashConfig.scrollback = BRIDGE_SCROLL_INTERNAL;
+
+  for (size = 1; size * 2 <= flashConfig.scrollback; size *= 2)
+    ;
+
+  if (size > BRIDGE_SCROLL_INTERNAL)
+    scrollBuf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  else
+    scrollBuf = malloc(size);
+
+  if (scrollBuf == NULL)
+  {
+    ESP_LOGE(TAG, "No memory for %u byte scrollback", (unsigned)size);
+    return;
+  }
+
+  scrollSize = size;
+  ESP_LOGI(TAG, "Scrollback %u bytes", (unsigned)size);
+}
+
+static void bridgeClose(int i)
+{
+  char *queue;
+  int sock;
+
+  // the parser only sees the socket and the queue, the rest is the loop's
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  sock = Clients[i].sock;
+  queue = Clients[i].queue.buf;
+  Clients[i].sock = -1;
+  Clients[i].queue.buf = NULL;
+  xSemaphoreGive(clientLock);
+
+  shutdown(sock, 0);
+  close(sock);
+  free(queue);
+  free(Clients[i].out);
+  Clients[i].out = NULL;
+  free(Clients[i].lz);
+  free(Clients[i].lzOut);
+  Clients[i].lz = NULL;
+  Clients[i].lzOut = NULL;
+
+  // a parser held off by this client can go on
+  xSemaphoreGive(bridgeSpace);
+
+  if (writer == i)
+    writer = -1;
+
+  bridgeCloses++;
+
+  ESP_LOGI(TAG, "Connection closed: %s", Clients[i].addr);
+}
+
+/**
+ * @brief probe a quiet connection so a peer that vanished is noticed
+ * @param sock client socket
+ */
+static void bridgeKeepalive(int sock)
+{
+  int on = 1;
+
+  if (flashConfig.keep_idle <= 0)
+    return;
+
+  setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &flashConfig.keep_idle, sizeof(flashConfig.keep_idle));
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &flashConfig.keep_interval, sizeof(flashConfig.keep_interval));
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &flashConfig.keep_count, sizeof(flashConfig.keep_count));
+}
+
+static void bridgeAccept(int listen_sock)
+{
+  struct sockaddr_in source_addr;
+  socklen_t addr_len = sizeof(source_addr);
+  int sock, i, n, slot, oldest;
+
+  sock = accept(listen_sock, (struct sockaddr*) & source_addr, &addr_len);
+  if (sock < 0)
+  {
+    ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+    return;
+  }
+
+  n = 0;
+  slot = -1;
+  oldest = -1;
+  for (i = 0; i < BRIDGE_MAX; i++)
+  {
+    if (Clients[i].sock >= 0)
+    {
+      n++;
+      if ((oldest < 0) || (Clients[i].connected < Clients[oldest].connected))
+        oldest = i;
+    }
+    else if (slot < 0)
+      slot = i;
+  }
+
+  // newest client wins, a laptop that vanished is the one replaced
+  if (((n >= bridgeLimit()) || (slot < 0)) && flashConfig.bridge_takeover && (oldest >= 0))
+  {
+    ESP_LOGW(TAG, "Taking over from %s", Clients[oldest].addr);
+    bridgeClose(oldest);
+    n--;
+    if (slot < 0)
+      slot = oldest;
+  }
+
+  if ((n >= bridgeLimit()) || (slot < 0))
+  {
+    ESP_LOGW(TAG, "Refusing connection, %d clients", n);
+    close(sock);
+    return;
+  }
+
+  Clients[slot].queue.buf = malloc(BRIDGE_QUEUE);
+  Clients[slot].out = malloc(BRIDGE_OUT);
+  if ((Clients[slot].queue.buf == NULL) || (Clients[slot].out == NULL))
+  {
+    ESP_LOGE(TAG, "No memory for client queue");
+    free(Clients[slot].queue.buf);
+    free(Clients[slot].out);
+    Clients[slot].queue.buf = NULL;
+    Clients[slot].out = NULL;
+    close(sock);
+    return;
+  }
+
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  Clients[slot].queue.size = BRIDGE_QUEUE;
+  Clients[slot].queue.ready = NULL;
+  Clients[slot].queue.high = 0;
+  atomic_store(&Clients[slot].queue.head, 0);
+  atomic_store(&Clients[slot].queue.tail, 0);
+  Clients[slot].queue.space = NULL;
+  atomic_store(&Clients[slot].queue.full, false);
+  Clients[slot].outLen = 0;
+  Clients[slot].outPos = 0;
+  Clients[slot].outBase = 0;
+  Clients[slot].markCount = 0;
+  Clients[slot].sock = sock;
+  Clients[slot].last = 0;
+  Clients[slot].stamp = esp_timer_get_time();
+  Clients[slot].connected = Clients[slot].stamp;
+  Clients[slot].active = Clients[slot].stamp;
+  Clients[slot].kill = false;
+  Clients[slot].due = false;
+  Clients[slot].checked = false;
+  Clients[slot].telnet = false;
+  Clients[slot].iacOut = false;
+  Clients[slot].suspended = false;
+  Clients[slot].tState = TS_DATA;
+  Clients[slot].dtr = 9;
+  Clients[slot].rts = 12;
+  Clients[slot].lz = NULL;
+  Clients[slot].lzOut = NULL;
+  Clients[slot].lzLen = 0;
+  Clients[slot].lzPos = 0;
 
-  len = recv(currentSocket, rx_buffer, sizeof(rx_buffer), 0);
-  
-  len = 0;
-  do
+  // the lock keeps replay and live output in step
+  if (flashConfig.replay > 0)
   {
-      len = recv(currentSocket, rx_buffer, sizeof(rx_buffer), 0);
-      if (len < 0)
+    scrollReplay(&Clients[slot].queue, flashConfig.replay);
+    bridgeMark(&Clients[slot], Clients[slot].stamp);
+    Clients[slot].due = true;
+  }
+  inet_ntoa_r(source_addr.sin_addr.s_addr, Clients[slot].addr, sizeof(Clients[slot].addr) - 1);
+  xSemaphoreGive(clientLock);
+
+  bridgeMode(slot);
+  bridgeKeepalive(sock);
+
+  bridgeConnects++;
+  ESP_LOGI(TAG, "Connecting to: %s (%d of %d)", Clients[slot].addr, n + 1, bridgeLimit());
+}
+
+/**
+ * @brief decide whether a client's input goes to the uart
+ * @param i client
+ * @param now current time
+ * @return true if the input is forwarded
+ */
+static bool bridgeWriter(int i, int64_t now)
+{
+  if (flashConfig.bridge_merge == BRIDGE_MERGE_ALL)
+    return true;
+
+  // the uart passes to another client once the writer goes quiet
+  if ((writer < 0) || (writer == i) || (now - Clients[writer].last > BRIDGE_FLOOR_MS * 1000))
+  {
+    writer = i;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief send a telnet reply to a client without blocking the loop
+ * @param c client
+ * @param data reply
+ * @param len length of reply
+ *
+ * A reply the socket will not take drops the client, the same as
+ * output that falls behind under BRIDGE_DISCONNECT.
+ */
+static void telnetReply(bridge_client *c, const uint8_t *data, int len)
+{
+  int64_t start;
+  int n;
+
+  // once compressing, replies travel in the stream behind unsent output
+  // and whatever the socket does not take now goes out from bridgeWrite
+  if (c->lz != NULL)
+  {
+    memmove(c->lzOut, &c->lzOut[c->lzPos], c->lzLen - c->lzPos);
+    c->lzLen -= c->lzPos;
+    c->lzPos = 0;
+    if (c->lzLen + LZSS_BOUND(len) > LZ_OUT)
+    {
+      c->kill = true;
+      return;
+    }
+    start = esp_timer_get_time();
+    c->lzLen += lzssEncode(c->lz, data, len, &c->lzOut[c->lzLen]);
+    lzTime += esp_timer_get_time() - start;
+    n = send(c->sock, c->lzOut, c->lzLen, MSG_DONTWAIT);
+    if (n > 0)
+      c->lzPos = n;
+    else if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+      c->kill = true;
+    return;
+  }
+
+  // finish an escaped 0xFF first or the reply would land inside it
+  if (c->iacOut)
+  {
+    if (send(c->sock, "\xff", 1, MSG_DONTWAIT) != 1)
+    {
+      c->kill = true;
+      return;
+    }
+    c->iacOut = false;
+  }
+
+  // a reply is a few bytes, a socket that cannot take them is stuck
+  if (send(c->sock, data, len, MSG_DONTWAIT) != len)
+    c->kill = true;
+}
+
+/**
+ * @brief agree to compress output and mark where it starts
+ * @param c client
+ * @return false if compression is off or there is no memory
+ */
+static bool lzStart(bridge_client *c)
+{
+  static const uint8_t start[] = { IAC, WILL, OPT_LZSS, IAC, SB, OPT_LZSS, IAC, SE };
+  lzss_encoder *lz;
+
+  if (!flashConfig.bridge_compress)
+    return false;
+  if (c->lz != NULL)
+    return true;
+
+  lz = malloc(sizeof(lzss_encoder));
+  c->lzOut = malloc(LZ_OUT);
+  if ((lz == NULL) || (c->lzOut == NULL))
+  {
+    ESP_LOGE(TAG, "No memory to compress for %s", c->addr);
+    free(lz);
+    free(c->lzOut);
+    c->lzOut = NULL;
+    return false;
+  }
+
+  lzssInit(lz);
+  c->lzLen = 0;
+  c->lzPos = 0;
+
+  // the marker goes out plain, the encoder takes over after it
+  telnetReply(c, start, sizeof(start));
+  c->lz = lz;
+  ESP_LOGI(TAG, "Compressing for %s", c->addr);
+  return true;
+}
+
+static void telnetOption(bridge_client *c, uint8_t verb, uint8_t option)
+{
+  uint8_t reply[3] = { IAC, 0, option };
+
+  if ((verb == DO) && (option == OPT_LZSS))
+  {
+    if (!lzStart(c))
+    {
+      reply[1] = WONT;
+      telnetReply(c, reply, 3);
+    }
+    return;
+  }
+
+  // only requests are answered so negotiation can never loop
+  if (verb == WILL)
+    reply[1] = ((option == OPT_BINARY) || (option == OPT_SGA) || (option == OPT_COMPORT)) ? DO : DONT;
+  else if (verb == DO)
+    reply[1] = ((option == OPT_BINARY) || (option == OPT_SGA) || (option == OPT_COMPORT)) ? WILL : WONT;
+  else
+    return;
+
+  telnetReply(c, reply, 3);
+}
+
+/**
+ * @brief answer an RFC 2217 command with a value
+ * @param c client
+ * @param cmd command from the client
+ * @param value reply value
+ * @param len bytes of value
+ */
+static void comPortReply(bridge_client *c, uint8_t cmd, const uint8_t *value, int len)
+{
+  uint8_t reply[32];
+  int n, i;
+
+  n = 0;
+  reply[n++] = IAC;
+  reply[n++] = SB;
+  reply[n++] = OPT_COMPORT;
+  reply[n++] = cmd + CPC_REPLY;
+  for (i = 0; (i < len) && (n < sizeof(reply) - 3); i++)
+  {
+    reply[n++] = value[i];
+    if (value[i] == IAC)
+      reply[n++] = IAC;
+  }
+  reply[n++] = IAC;
+  reply[n++] = SE;
+
+  telnetReply(c, reply, n);
+}
+
+static void comPortCommand(bridge_client *c)
+{
+  static const char signature[] = "Parallax WX";
+  uint8_t *v = &c->sb[2];
+  uint8_t value[4];
+  uint32_t baud;
+
+  if ((c->sbLen < 2) || (c->sb[0] != OPT_COMPORT))
+    return;
+
+  switch (c->sb[1])
+  {
+  case CPC_SIGNATURE:
+    comPortReply(c, CPC_SIGNATURE, (const uint8_t*)signature, sizeof(signature) - 1);
+    break;
+  case CPC_SET_BAUDRATE:
+    if (c->sbLen < 6)
+      return;
+    baud = ((uint32_t)v[0] << 24) | ((uint32_t)v[1] << 16) | ((uint32_t)v[2] << 8) | v[3];
+    // applied by the parser task for this session only, 0 asks for the rate
+    if (baud != 0)
+      baud = parserRequestBaud(baud > INT32_MAX ? INT32_MAX : baud);
+    else
+      baud = parserBaudRate();
+    value[0] = baud >> 24;
+    value[1] = baud >> 16;
+    value[2] = baud >> 8;
+    value[3] = baud;
+    comPortReply(c, CPC_SET_BAUDRATE, value, 4);
+    break;
+  case CPC_SET_DATASIZE:
+  case CPC_SET_PARITY:
+  case CPC_SET_STOPSIZE:
+    // the link is fixed at 8N1
+    value[0] = c->sb[1] == CPC_SET_DATASIZE ? 8 : 1;
+    comPortReply(c, c->sb[1], value, 1);
+    break;
+  case CPC_SET_CONTROL:
+    if (c->sbLen < 3)
+      return;
+    switch (v[0])
+    {
+    case 0:
+      value[0] = flashConfig.flow_ctrl == FLOW_RTS_CTS ? 3 : flashConfig.flow_ctrl == FLOW_XON_XOFF ? 2 : 1;
+      break;
+    case 4:
+      value[0] = c->dtr;
+      break;
+    case 7:
+      value[0] = c->rts;
+      break;
+    case 8:
+    case 11:
+      // asserting DTR or RTS is how serial loaders reset the Propeller
+      if (((v[0] == 8) && (c->dtr != 8)) || ((v[0] == 11) && (c->rts != 11)))
+        statusResetAsync();
+      /* fall through */
+    case 9:
+    case 12:
+      if (v[0] <= 9)
+        c->dtr = v[0];
+      else
+        c->rts = v[0];
+      value[0] = v[0];
+      break;
+    default:
+      value[0] = v[0];
+    }
+    comPortReply(c, CPC_SET_CONTROL, value, 1);
+    break;
+  case CPC_FLOW_SUSPEND:
+    c->suspended = true;
+    break;
+  case CPC_FLOW_RESUME:
+    c->suspended = false;
+    break;
+  case CPC_PURGE_DATA:
+    if ((c->sbLen >= 3) && (v[0] & 1))
+      uart_flush_input(UART_NUM_0);
+    comPortReply(c, CPC_PURGE_DATA, v, c->sbLen >= 3 ? 1 : 0);
+    break;
+  default:
+    // line and modem state masks and anything newer are acknowledged as is
+    comPortReply(c, c->sb[1], v, c->sbLen - 2);
+  }
+}
+
+/**
+ * @brief strip telnet commands from client input in place
+ * @param c client
+ * @param buf input
+ * @param len length of input
+ * @return length of the data left
+ */
+static int telnetInput(bridge_client *c, char *buf, int len)
+{
+  char *p;
+  uint8_t b;
+  int i, o, n;
+
+  i = 0;
+  o = 0;
+  while (i < len)
+  {
+    if (c->tState == TS_DATA)
+    {
+      // whole runs between commands move at once
+      p = memchr(&buf[i], IAC, len - i);
+      n = (p == NULL) ? len - i : p - &buf[i];
+      if (o != i)
+        memmove(&buf[o], &buf[i], n);
+      o += n;
+      i += n;
+      if (p != NULL)
       {
-          ESP_LOGE(TAG, "Error occurred during receiving: errno %d", errno);
+        c->tState = TS_IAC;
+        i++;
+      }
+      continue;
+    }
+
+    b = buf[i++];
+    switch (c->tState)
+    {
+    case TS_IAC:
+      if (b == IAC)
+      {
+        buf[o++] = IAC;
+        c->tState = TS_DATA;
+      }
+      else if ((b >= WILL) && (b <= DONT))
+      {
+        c->tVerb = b;
+        c->tState = TS_OPT;
+      }
+      else if (b == SB)
+      {
+        c->sbLen = 0;
+        c->tState = TS_SB;
       }
       else
       {
-          if (len == 0)
-          {
-              ESP_LOGI(TAG, "Connection closed");
-          }
-          else
-          {
-              receive(rx_buffer, len);
-          }
+        c->tState = TS_DATA;
+      }
+      break;
+    case TS_OPT:
+      telnetOption(c, c->tVerb, b);
+      c->tState = TS_DATA;
+      break;
+    case TS_SB:
+      if (b == IAC)
+        c->tState = TS_SB_IAC;
+      else if (c->sbLen < sizeof(c->sb))
+        c->sb[c->sbLen++] = b;
+      break;
+    case TS_SB_IAC:
+      if (b == SE)
+      {
+        comPortCommand(c);
+        c->tState = TS_DATA;
+      }
+      else
+      {
+        if (c->sbLen < sizeof(c->sb))
+          c->sb[c->sbLen++] = b;
+        c->tState = TS_SB;
+      }
+      break;
+    }
+  }
+
+  return o;
+}
+
+/**
+ * @brief telnet clients announce themselves with a negotiation first
+ * @param c client
+ * @param buf first input
+ * @param len length of input
+ */
+static void telnetCheck(bridge_client *c, char *buf, int len)
+{
+  uint8_t verb;
+
+  if (c->checked)
+    return;
+
+  // raw data may well start with 0xFF, only IAC and a verb count
+  c->checked = true;
+  verb = len > 1 ? (uint8_t)buf[1] : 0;
+  c->telnet = ((uint8_t)buf[0] == IAC) && (((verb >= WILL) && (verb <= DONT)) || (verb == SB));
+  if (c->telnet)
+    ESP_LOGI(TAG, "Telnet client %s", c->addr);
+}
+
+static void bridgeRead(int i, ring_t *ring)
+{
+  char discard[64];
+  char *data;
+  int64_t now;
+  int len, n;
+
+  now = esp_timer_get_time();
+  if (bridgeWriter(i, now))
+  {
+    len = ringWriteSpace(ring, &data);
+    len = recv(Clients[i].sock, data, len, 0);
+    if (len > 0)
+    {
+      telnetCheck(&Clients[i], data, len);
+      n = len;
+      if (Clients[i].telnet)
+        n = telnetInput(&Clients[i], data, len);
+      Clients[i].last = now;
+      Clients[i].active = now;
+      bridgeIn += len;
+      if (n > 0)
+        ringCommit(ring, n);
+    }
+  }
+  else
+  {
+    // commands from a client without the uart still count
+    len = recv(Clients[i].sock, discard, sizeof(discard), 0);
+    if (len > 0)
+    {
+      telnetCheck(&Clients[i], discard, len);
+      if (Clients[i].telnet)
+        telnetInput(&Clients[i], discard, len);
+    }
+  }
+
+  if (len < 0)
+    ESP_LOGE(TAG, "Error occurred during receiving: errno %d", errno);
+  if (len <= 0)
+    bridgeClose(i);
+}
+
+/**
+ * @brief send queued output to a telnet client doubling 0xFF
+ * @param c client
+ * @param data queued output
+ * @param len length of output
+ * @return bytes of output sent or -1
+ */
+static int telnetOutput(bridge_client *c, char *data, int len)
+{
+  char *p;
+  int n;
+
+  if (c->iacOut)
+  {
+    n = send(c->sock, "\xff", 1, MSG_DONTWAIT);
+    if (n <= 0)
+      return n;
+    c->iacOut = false;
+  }
+
+  if (len == 0)
+    return 0;
+
+  // send up to and including the next 0xFF, then its double
+  p = memchr(data, IAC, len);
+  if (p != NULL)
+    len = p - data + 1;
+
+  n = send(c->sock, data, len, MSG_DONTWAIT);
+  if ((n == len) && (p != NULL))
+  {
+    if (send(c->sock, "\xff", 1, MSG_DONTWAIT) != 1)
+      c->iacOut = true;
+  }
+
+  return n;
+}
+
+/**
+ * @brief code taken output into a block and send what the socket will take
+ * @param c client
+ * @return bytes of output coded or -1
+ */
+static int lzOutput(bridge_client *c)
+{
+  static uint8_t plain[LZSS_BLOCK];
+  int64_t start;
+  int taken, n;
+
+  taken = 0;
+  if (c->lzPos == c->lzLen)
+  {
+    if (c->outPos == c->outLen)
+      return 0;
+
+    // the compressed stream is still telnet, so 0xFF is doubled first
+    n = 0;
+    while ((c->outPos < c->outLen) && (n < LZSS_BLOCK - 1))
+    {
+      plain[n++] = c->out[c->outPos];
+      if ((uint8_t)c->out[c->outPos] == IAC)
+        plain[n++] = IAC;
+      c->outPos++;
+      taken++;
+    }
+
+    start = esp_timer_get_time();
+    c->lzLen = lzssEncode(c->lz, plain, n, c->lzOut);
+    c->lzPos = 0;
+    lzTime += esp_timer_get_time() - start;
+    lzIn += n;
+    lzOutTotal += c->lzLen;
+  }
+
+  n = send(c->sock, &c->lzOut[c->lzPos], c->lzLen - c->lzPos, MSG_DONTWAIT);
+  if (n > 0)
+    c->lzPos += n;
+  else if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+    return -1;
+
+  return taken;
+}
+
+/**
+ * @brief count a send in the latency histogram, called with the lock held
+ * @param c client
+ */
+static void bridgeAge(bridge_client *c)
+{
+  int64_t age;
+  int b;
+
+  age = esp_timer_get_time() - c->stamp;
+  for (b = 0; (b < BRIDGE_LATENCY_BUCKETS - 1) && (age >= ((int64_t)BRIDGE_LATENCY_MIN << b)); b++)
+    ;
+  bridgeLatency[b]++;
+}
+
+/**
+ * @brief move queued output to the client's send buffer, called with the lock held
+ * @param c client
+ * @return bytes taken
+ */
+static int bridgeTake(bridge_client *c)
+{
+  char *data;
+  int len;
+
+  c->outLen = 0;
+  c->outPos = 0;
+  while (c->outLen < BRIDGE_OUT)
+  {
+    len = ringPeek(&c->queue, &data);
+    if (len == 0)
+      break;
+    if (len > BRIDGE_OUT - c->outLen)
+      len = BRIDGE_OUT - c->outLen;
+    memcpy(&c->out[c->outLen], data, len);
+    ringConsume(&c->queue, len);
+    c->outLen += len;
+  }
+
+  return c->outLen;
+}
+
+/**
+ * @brief send what a client's socket will take without blocking
+ * @param i client
+ * @return false if the connection failed
+ *
+ * Only the copy out of the queue happens under the lock, the parser goes
+ * on queueing while this client compresses and sends.
+ */
+static bool bridgeWrite(int i)
+{
+  bridge_client *c = &Clients[i];
+  int taken, n, err;
+
+  taken = 0;
+  if ((c->outPos == c->outLen) && ((c->lz == NULL) || (c->lzPos == c->lzLen)))
+  {
+    // everything before the queue tail has been sent or dropped
+    xSemaphoreTake(clientLock, portMAX_DELAY);
+    c->outBase = atomic_load(&c->queue.tail);
+    bridgeSent(c, c->outBase);
+    taken = bridgeTake(c);
+    xSemaphoreGive(clientLock);
+  }
+
+  n = 0;
+  if (c->lz != NULL)
+    n = lzOutput(c);
+  else if (c->telnet)
+    n = telnetOutput(c, &c->out[c->outPos], c->outLen - c->outPos);
+  else if (c->outPos < c->outLen)
+    n = send(c->sock, &c->out[c->outPos], c->outLen - c->outPos, MSG_DONTWAIT);
+  err = errno;
+  if ((n > 0) && (c->lz == NULL))
+    c->outPos += n;
+
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  if (n > 0)
+  {
+    c->active = esp_timer_get_time();
+    bridgeAge(c);
+    bridgeOut += n;
+  }
+
+  // a coded block counts once all of it is out
+  if ((c->lz == NULL) || (c->lzPos == c->lzLen))
+    bridgeSent(c, c->outBase + c->outPos);
+  if ((ringUsed(&c->queue) == 0) && !bridgeStaged(c))
+    c->due = false;
+  else
+    bridgeArm();
+  xSemaphoreGive(clientLock);
+
+  if ((n < 0) && (err != EAGAIN) && (err != EWOULDBLOCK))
+  {
+    ESP_LOGE(TAG, "Error occurred during sending: errno %d", err);
+    return false;
+  }
+
+  if (taken > 0)
+    xSemaphoreGive(bridgeSpace);
+
+  return true;
+}
+
+/**
+ * @brief send the frame being built, called with the udp lock held
+ */
+static void udpFlush(void)
+{
+  if ((udpFill > 0) && udpHavePeer)
+  {
+    if (sendto(udpSock, udpFrame, udpFill, MSG_DONTWAIT, (struct sockaddr*)&udpPeer, sizeof(udpPeer)) == udpFill)
+      udpFrames++;
+    else
+      udpLost++;
+  }
+  udpFill = 0;
+}
+
+static void udpIdle(void *arg)
+{
+  xSemaphoreTake(udpLock, portMAX_DELAY);
+  udpFlush();
+  xSemaphoreGive(udpLock);
+}
+
+/**
+ * @brief cut uart output into datagrams
+ * @param data output
+ * @param len length of output
+ */
+static void udpSend(char *data, int len)
+{
+  char *p;
+  int n, size;
+
+  if (udpSock < 0)
+    return;
+
+  size = flashConfig.udp_size;
+  if ((size < 1) || (size > BRIDGE_UDP_MAX))
+    size = BRIDGE_UDP_MAX;
+
+  xSemaphoreTake(udpLock, portMAX_DELAY);
+  while (len > 0)
+  {
+    n = size - udpFill;
+    if (n > len)
+      n = len;
+
+    p = NULL;
+    if (flashConfig.udp_frame == UDP_FRAME_DELIMITER)
+    {
+      p = memchr(data, flashConfig.udp_delimiter, n);
+      if (p != NULL)
+        n = p - data + 1;
+    }
+
+    memcpy(&udpFrame[udpFill], data, n);
+    udpFill += n;
+    data += n;
+    len -= n;
+
+    // every mode ends a frame at the size limit
+    if ((p != NULL) || (udpFill >= size))
+      udpFlush();
+  }
+  xSemaphoreGive(udpLock);
+
+  // idle framing ends the frame once the uart has been quiet for the gap
+  if ((flashConfig.udp_frame == UDP_FRAME_IDLE) && (udpFill > 0))
+  {
+    esp_timer_stop(udpTimer);
+    esp_timer_start_once(udpTimer, flashConfig.udp_idle);
+  }
+}
+
+/**
+ * @brief pass a datagram to the uart whole or not at all
+ * @param ring telnet ring
+ */
+static void udpRead(ring_t *ring)
+{
+  static char datagram[BRIDGE_UDP_MAX];
+  struct sockaddr_in from;
+  socklen_t fromLen = sizeof(from);
+  int len;
+
+  len = recvfrom(udpSock, datagram, sizeof(datagram), 0, (struct sockaddr*)&from, &fromLen);
+  if (len <= 0)
+    return;
+
+  // without a configured peer, answer whoever spoke last
+  if (flashConfig.udp_peer_ip == 0)
+  {
+    xSemaphoreTake(udpLock, portMAX_DELAY);
+    udpPeer = from;
+    udpHavePeer = true;
+    xSemaphoreGive(udpLock);
+  }
+
+  if (ringFree(ring) >= len)
+    ringWrite(ring, datagram, len);
+  else
+    udpLost++;
+}
+
+/**
+ * @brief open the udp bridge socket if a port is configured
+ */
+static void udpInit(void)
+{
+  struct sockaddr_in addr;
+
+  if (flashConfig.udp_port <= 0)
+    return;
+
+  udpSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+  if (udpSock < 0)
+  {
+    ESP_LOGE(TAG, "Unable to create udp socket: errno %d", errno);
+    return;
+  }
+
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(flashConfig.udp_port);
+  if (bind(udpSock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+  {
+    ESP_LOGE(TAG, "Udp socket unable to bind: errno %d", errno);
+    close(udpSock);
+    udpSock = -1;
+    return;
+  }
+
+  if (flashConfig.udp_peer_ip != 0)
+  {
+    udpPeer.sin_family = AF_INET;
+    udpPeer.sin_addr.s_addr = flashConfig.udp_peer_ip;
+    udpPeer.sin_port = htons(flashConfig.udp_peer_port);
+    udpHavePeer = true;
+  }
+
+  ESP_LOGI(TAG, "Udp bound, port %d", flashConfig.udp_port);
+}
+
+int serbridgeSend(char* data, int len)
+{
+  ring_t *q;
+  uint64_t one = 1;
+  bool wake = false;
+  bool ready, line;
+  int64_t now;
+  int i, n, room;
+
+  if (clientLock == NULL)
+    return len;
+
+  now = esp_timer_get_time();
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+
+  // under backpressure take only what every queue can hold, a suspended
+  // client is not reading and drops its oldest output instead
+  if (flashConfig.bridge_policy == BRIDGE_BACKPRESSURE)
+  {
+    for (i = 0; i < BRIDGE_MAX; i++)
+    {
+      if ((Clients[i].sock < 0) || Clients[i].kill || Clients[i].suspended)
+        continue;
+      room = ringFree(&Clients[i].queue);
+      if (room < len)
+        len = room;
+    }
+  }
+
+  scrollWrite(data, len);
+
+  line = (flashConfig.bridge_mode == BRIDGE_LINE) && (memchr(data, '\n', len) != NULL);
+
+  for (i = 0; i < BRIDGE_MAX; i++)
+  {
+    if ((Clients[i].sock < 0) || Clients[i].kill)
+      continue;
+
+    q = &Clients[i].queue;
+    ready = bridgeQueued(i);
+    room = ringFree(q);
+    if (room < len)
+    {
+      if (flashConfig.bridge_policy == BRIDGE_DISCONNECT)
+      {
+        Clients[i].kill = true;
+        bridgeKilled++;
+        wake = true;
+        continue;
       }
-  } while (len > 0);
+
+      // drop the oldest bytes, then the start of data larger than the queue
+      n = len - room;
+      if (n > ringUsed(q))
+        n = ringUsed(q);
+      ringConsume(q, n);
+      bridgeDropped += n;
+      if (len > q->size)
+        bridgeDropped += len - q->size;
+    }
+
+    if (ringUsed(q) == 0)
+      bridgeArm();
+    if (len > q->size)
+      ringWrite(q, &data[len - q->size], q->size);
+    else
+      ringWrite(q, data, len);
+    bridgeMark(&Clients[i], now);
+
+    if (line)
+      Clients[i].due = true;
+
+    // wake the loop only when this data made the queue sendable
+    if (!ready && bridgeQueued(i))
+      wake = true;
+  }
+
+  xSemaphoreGive(clientLock);
+
+  if (wake)
+    write(wakeFd, &one, sizeof(one));
+
+  udpSend(data, len);
+
+  return len;
+}
+
+void serbridgeWait(void)
+{
+  xSemaphoreTake(bridgeSpace, BRIDGE_WAIT_MS / portTICK_PERIOD_MS);
 }
 
-void serbridgeSend(char* data, int len)
+void serbridgeStats(bridge_stats *stats)
 {
-    if (currentSocket >= 0)
-        send(currentSocket, data, len, 0);
+  int i, used;
+
+  memset(stats, 0, sizeof(bridge_stats));
+
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  for (i = 0; i < BRIDGE_MAX; i++)
+  {
+    if (Clients[i].sock < 0)
+      continue;
+    stats->clients++;
+    used = ringUsed(&Clients[i].queue);
+    if (used > stats->depth)
+      stats->depth = used;
+    if (Clients[i].queue.high > stats->high)
+      stats->high = Clients[i].queue.high;
+  }
+  stats->dropped = bridgeDropped;
+  stats->lzIn = lzIn;
+  stats->lzOut = lzOutTotal;
+  stats->lzTime = lzTime;
+  stats->connects = bridgeConnects;
+  stats->closes = bridgeCloses;
+  stats->tcpIn = bridgeIn;
+  stats->tcpOut = bridgeOut;
+  memcpy(stats->latency, bridgeLatency, sizeof(bridgeLatency));
+  stats->udpFrames = udpFrames;
+  stats->udpLost = udpLost;
+  stats->disconnects = bridgeKilled;
+  xSemaphoreGive(clientLock);
 }
 
+int serbridgeSetPeer(const char *text)
+{
+  char host[16];
+  const char *colon;
+  struct in_addr addr;
+  int port = 0;
+
+  colon = strchr(text, ':');
+  if (colon == NULL)
+    colon = text + strlen(text);
+  else
+    port = atoi(colon + 1);
+  if ((colon - text) >= sizeof(host))
+    return -1;
+  memcpy(host, text, colon - text);
+  host[colon - text] = 0;
+  if (inet_aton(host, &addr) == 0)
+    return -1;
+
+  flashConfig.udp_peer_ip = addr.s_addr;
+  flashConfig.udp_peer_port = port;
+
+  // takes effect now, a zero address goes back to learning the peer
+  if (udpLock != NULL)
+  {
+    xSemaphoreTake(udpLock, portMAX_DELAY);
+    udpPeer.sin_family = AF_INET;
+    udpPeer.sin_addr.s_addr = addr.s_addr;
+    udpPeer.sin_port = htons(port);
+    udpHavePeer = (addr.s_addr != 0);
+    xSemaphoreGive(udpLock);
+  }
+  return 0;
+}
+
+
+/**
+ * @brief drop clients that went idle or stopped taking output
+ * @param now current time
+ */
+static void bridgeSweep(int64_t now)
+{
+  int64_t stall, since;
+  int i;
+
+  // keepalive cannot probe while output is unacknowledged, so a stuck queue
+  // gets the same time a quiet connection would
+  stall = (int64_t)(flashConfig.keep_idle + flashConfig.keep_interval * flashConfig.keep_count) * 1000000;
+
+  for (i = 0; i < BRIDGE_MAX; i++)
+  {
+    if (Clients[i].sock < 0)
+      continue;
+
+    if ((flashConfig.bridge_idle > 0) && (now - Clients[i].active > (int64_t)flashConfig.bridge_idle * 1000000))
+    {
+      ESP_LOGW(TAG, "Dropping idle client %s", Clients[i].addr);
+      bridgeClose(i);
+      continue;
+    }
+
+    since = Clients[i].active > Clients[i].stamp ? Clients[i].active : Clients[i].stamp;
+    if ((flashConfig.keep_idle > 0) && !Clients[i].suspended && ((ringUsed(&Clients[i].queue) > 0) || bridgeStaged(&Clients[i])) && (now - since > stall))
+    {
+      ESP_LOGW(TAG, "Dropping stalled client %s", Clients[i].addr);
+      bridgeClose(i);
+    }
+  }
+}
 
 static void serbridge(void* pvParameters)
 {
@@ -55,8 +1472,14 @@ static void serbridge(void* pvParameters)
   int addr_family;
   int ip_protocol;
   int err;
+  int i, maxfd;
+  bool space;
+  uint64_t count;
+  int64_t now, swept;
+  fd_set readfds, writefds;
+  struct timeval wait;
+  ring_t *ring = receiveRing(RECEIVE_TELNET);
 
-  currentSocket = -1;
   struct sockaddr_in dest_addr;
   dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
   dest_addr.sin_family = AF_INET;
@@ -81,31 +1504,107 @@ static void serbridge(void* pvParameters)
   }
   ESP_LOGI(TAG, "Socket bound, port %d", _PORT);
 
-  err = listen(listen_sock, 1);
+  err = listen(listen_sock, BRIDGE_MAX);
   if (err != 0)
   {
       ESP_LOGE(TAG, "Error occurred during listen: errno %d", errno);
       goto CLEAN_UP;
   }
 
+  swept = 0;
   while (true)
   {
-      struct sockaddr_in6 source_addr;
-      socklen_t addr_len = sizeof(source_addr);
-      currentSocket = accept(listen_sock, (struct sockaddr*) & source_addr, &addr_len);
-      if (currentSocket < 0)
+      now = esp_timer_get_time();
+      if (now - swept >= BRIDGE_SWEEP_MS * 1000)
+      {
+          bridgeSweep(now);
+          swept = now;
+      }
+
+      FD_ZERO(&readfds);
+      FD_ZERO(&writefds);
+      FD_SET(listen_sock, &readfds);
+      FD_SET(wakeFd, &readfds);
+      maxfd = listen_sock > wakeFd ? listen_sock : wakeFd;
+
+      for (i = 0; i < BRIDGE_MAX; i++)
+      {
+          if (Clients[i].sock < 0)
+              continue;
+          if (Clients[i].kill)
+          {
+              ESP_LOGW(TAG, "Dropping slow client %s", Clients[i].addr);
+              bridgeClose(i);
+              continue;
+          }
+          if (Clients[i].mode != flashConfig.bridge_mode)
+              bridgeMode(i);
+          if (bridgeReady(i) && !Clients[i].suspended)
+          {
+              FD_SET(Clients[i].sock, &writefds);
+              if (Clients[i].sock > maxfd)
+                  maxfd = Clients[i].sock;
+          }
+      }
+
+      // with the ring full, leave input in the sockets so tcp holds the clients off
+      // until the parser's consume wakes the loop
+      space = (ringFree(ring) > 0) || !ringStall(ring);
+      if (space && (udpSock >= 0))
       {
-          ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
-          break;
+          FD_SET(udpSock, &readfds);
+          if (udpSock > maxfd)
+              maxfd = udpSock;
+      }
+      if (space)
+      {
+          for (i = 0; i < BRIDGE_MAX; i++)
+          {
+              if (Clients[i].sock < 0)
+                  continue;
+              FD_SET(Clients[i].sock, &readfds);
+              if (Clients[i].sock > maxfd)
+                  maxfd = Clients[i].sock;
+          }
       }
-      inet_ntoa_r(((struct sockaddr_in*) & source_addr)->sin_addr.s_addr, addr_str, sizeof(addr_str) - 1);
 
-      ESP_LOGI(TAG, "Connecting to: %s", addr_str);
-      doTerminal();
+      // the sweep needs a wakeup even when every client is quiet
+      wait.tv_sec = 0;
+      wait.tv_usec = BRIDGE_SWEEP_MS * 1000;
+      err = select(maxfd + 1, &readfds, &writefds, NULL, &wait);
+      if (err < 0)
+      {
+          ESP_LOGE(TAG, "Error occurred during select: errno %d", errno);
+          vTaskDelay(BRIDGE_WAIT_MS / portTICK_PERIOD_MS);
+          continue;
+      }
+
+      if (FD_ISSET(wakeFd, &readfds))
+          read(wakeFd, &count, sizeof(count));
+
+      for (i = 0; i < BRIDGE_MAX; i++)
+      {
+          if ((Clients[i].sock >= 0) && FD_ISSET(Clients[i].sock, &writefds))
+          {
+              if (!bridgeWrite(i))
+                  bridgeClose(i);
+          }
+      }
 
-      shutdown(currentSocket, 0);
-      close(currentSocket);
-      currentSocket = -1;
+      if (space)
+      {
+          for (i = 0; i < BRIDGE_MAX; i++)
+          {
+              if ((Clients[i].sock >= 0) && FD_ISSET(Clients[i].sock, &readfds))
+                  bridgeRead(i, ring);
+          }
+          if ((udpSock >= 0) && FD_ISSET(udpSock, &readfds))
+              udpRead(ring);
+      }
+
+      // accept last so a new socket is never tested against this round's sets
+      if (FD_ISSET(listen_sock, &readfds))
+          bridgeAccept(listen_sock);
   }
 
 CLEAN_UP:
@@ -117,6 +1616,35 @@ CLEAN_UP:
 // Start transparent serial bridge TCP server on specified port (typ. 23)
 void serbridgeInit(int port)
 {
+  int i;
+
   _PORT = port;
+  for (i = 0; i < BRIDGE_MAX; i++)
+    Clients[i].sock = -1;
+  clientLock = xSemaphoreCreateMutex();
+  bridgeSpace = xSemaphoreCreateBinary();
+  scrollInit();
+
+  esp_timer_create_args_t timer =
+  {
+    .callback = bridgeFlush,
+    .name = "bridgeflush"
+  };
+  esp_timer_create(&timer, &flushTimer);
+
+  esp_timer_create_args_t idle =
+  {
+    .callback = udpIdle,
+    .name = "udpidle"
+  };
+  udpLock = xSemaphoreCreateMutex();
+  esp_timer_create(&idle, &udpTimer);
+  udpInit();
+
+  esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+  esp_vfs_eventfd_register(&config);
+  wakeFd = eventfd(0, 0);
+  receiveRing(RECEIVE_TELNET)->space = bridgeSpaceFree;
+
   xTaskCreate(serbridge, "serialbridge", 4096, NULL, 5, NULL);
 }
@@ -2,7 +2,110 @@
 // Send buffer size
 #define MAX_TXBUFFER (2*1460)
 
+// concurrent bridge clients, flashConfig.bridge_clients sets the limit
+#define BRIDGE_MAX 8
+
+// quiet time before another client may take the uart
+#define BRIDGE_FLOOR_MS 1000
+
+// longest wait for client queues to drain before the uart is read again
+#define BRIDGE_WAIT_MS 10
+
+// how often connected clients are checked for idle and stalled sockets
+#define BRIDGE_SWEEP_MS 1000
+
+// uart output queued per client, a power of two
+#define BRIDGE_QUEUE 4096
+
+// output taken from a queue at once, a full batch, sent without the lock
+#define BRIDGE_OUT (BRIDGE_QUEUE / 2)
+
+// scrollback larger than this needs PSRAM
+#define BRIDGE_SCROLL_INTERNAL 16384
+
+// what happens when a client's queue is full
+enum
+{
+  BRIDGE_DROP_OLDEST = 0,   // discard the oldest queued output
+  BRIDGE_DISCONNECT = 1,    // close the slow client
+  BRIDGE_BACKPRESSURE = 2   // stop reading the uart until it drains
+};
+
+// forwarding latency histogram, bucket n counts sends under BRIDGE_LATENCY_MIN << n us
+#define BRIDGE_LATENCY_MIN 64
+#define BRIDGE_LATENCY_BUCKETS 14
+
+typedef struct
+{
+  uint32_t clients;
+  uint32_t depth;           // deepest queue now
+  uint32_t high;            // deepest queue of the connected clients
+  uint32_t dropped;         // bytes dropped under BRIDGE_DROP_OLDEST
+  uint32_t disconnects;     // clients closed under BRIDGE_DISCONNECT
+  uint32_t lzIn;            // bytes given to the compressor
+  uint32_t lzOut;           // bytes it produced
+  uint32_t lzTime;          // microseconds spent compressing
+  uint32_t udpFrames;       // datagrams sent
+  uint32_t udpLost;         // datagrams not sent or not taken
+  uint32_t connects;
+  uint32_t closes;
+  uint32_t tcpIn;           // bytes from clients
+  uint32_t tcpOut;          // bytes of uart output sent to clients
+  uint32_t latency[BRIDGE_LATENCY_BUCKETS]; // the last bucket is open ended
+} bridge_stats;
+
+// largest udp bridge datagram, one unfragmented ethernet payload
+#define BRIDGE_UDP_MAX 1472
+
+// how uart output is cut into datagrams
+enum
+{
+  UDP_FRAME_DELIMITER = 0,  // after each udp_delimiter byte
+  UDP_FRAME_IDLE = 1,       // when the uart is quiet for udp_idle us
+  UDP_FRAME_SIZE = 2        // every udp_size bytes
+};
+
+// when queued output is sent
+enum
+{
+  BRIDGE_INTERACTIVE = 0,   // at once, with TCP_NODELAY
+  BRIDGE_THROUGHPUT = 1,    // at bridge_batch bytes or bridge_delay us
+  BRIDGE_LINE = 2           // at a newline, else as BRIDGE_THROUGHPUT
+};
+
+// how client input is merged to the uart
+enum
+{
+  BRIDGE_MERGE_ONE = 0,     // one writer at a time
+  BRIDGE_MERGE_ALL = 1      // every client writes
+};
+
 
 void serbridgeInit(int port);
-void serbridgeSend(char*, int len);
+
+/**
+ * @brief Queue uart output to every bridge client without blocking
+ * @param data to send
+ * @param len length of data
+ * @return bytes taken, less than len only under BRIDGE_BACKPRESSURE
+ */
+int serbridgeSend(char*, int len);
+
+/**
+ * @brief Set the udp bridge peer
+ * @param text "address:port", an address of 0.0.0.0 answers the last sender
+ * @return 0 or -1 if text is not an address
+ */
+int serbridgeSetPeer(const char *text);
+
+/**
+ * @brief Wait a little for client queues to drain
+ */
+void serbridgeWait(void);
+
+/**
+ * @brief Snapshot of the client queues
+ * @param stats filled in
+ */
+void serbridgeStats(bridge_stats *stats);
 
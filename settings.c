@@ -11,6 +11,10 @@
 #include "driver/gpio.h"
 #include "settings.h"
 #include "config.h"
+#include "parser.h"
+#include "txsched.h"
+#include "serbridge.h"
+#include "capture.h"
 
 static const char* TAG = "settings";
 static esp_netif_t *Interface;
@@ -233,11 +237,161 @@ int setMACAddress(void *data, char *value)
 int setBaudrate(void *data, char *value)
 {
     flashConfig.baud_rate = atoi(value);
+    parserSetBaud(flashConfig.baud_rate);
     uart_flush_input(UART_NUM_0);
-    uart_set_baudrate(UART_NUM_0, flashConfig.baud_rate);
     return 0;
 }
 
+int getFraming(void *data, char *value)
+{
+    sprintf(value, "%d", parserFraming());
+    return 0;
+}
+
+int setFraming(void *data, char *value)
+{
+    return parserSetFraming(atoi(value));
+}
+
+int getTransparent(void *data, char *value)
+{
+    sprintf(value, "%d", parserTransparent() ? 1 : 0);
+    return 0;
+}
+
+int setTransparent(void *data, char *value)
+{
+    parserSetTransparent(atoi(value) != 0);
+    return 0;
+}
+
+int getTxDepth(void *data, char *value)
+{
+    tx_stats stats;
+
+    txGetStats(&stats);
+    sprintf(value, "%u", (unsigned)stats.depth);
+    return 0;
+}
+
+int getTxStall(void *data, char *value)
+{
+    tx_stats stats;
+
+    txGetStats(&stats);
+    sprintf(value, "%llu", (unsigned long long)stats.stallTime);
+    return 0;
+}
+
+int setFlowControl(void *data, char *value)
+{
+    int mode;
+
+    mode = atoi(value);
+    if (parserSetFlowControl(mode) != 0)
+        return -1;
+
+    flashConfig.flow_ctrl = mode;
+    return 0;
+}
+
+int getUartOverruns(void *data, char *value)
+{
+    uart_counters counters;
+
+    parserUartCounters(&counters);
+    sprintf(value, "%u", (unsigned)(counters.fifoOverflow + counters.bufferFull));
+    return 0;
+}
+
+int getUartErrors(void *data, char *value)
+{
+    uart_counters counters;
+
+    parserUartCounters(&counters);
+    sprintf(value, "%u", (unsigned)(counters.frameErrors + counters.parityErrors));
+    return 0;
+}
+
+int getBridgeDepth(void *data, char *value)
+{
+    bridge_stats stats;
+
+    serbridgeStats(&stats);
+    sprintf(value, "%u", (unsigned)stats.depth);
+    return 0;
+}
+
+int getBridgeDropped(void *data, char *value)
+{
+    bridge_stats stats;
+
+    serbridgeStats(&stats);
+    sprintf(value, "%u", (unsigned)stats.dropped);
+    return 0;
+}
+
+int getBridgeRatio(void *data, char *value)
+{
+    bridge_stats stats;
+
+    // percent of the input size sent, 100 before anything is compressed
+    serbridgeStats(&stats);
+    sprintf(value, "%u", stats.lzIn ? (unsigned)((uint64_t)stats.lzOut * 100 / stats.lzIn) : 100);
+    return 0;
+}
+
+int getBridgeLzTime(void *data, char *value)
+{
+    bridge_stats stats;
+
+    serbridgeStats(&stats);
+    sprintf(value, "%u", (unsigned)stats.lzTime);
+    return 0;
+}
+
+int setCapture(void *data, char *value)
+{
+    flashConfig.capture = atoi(value) != 0;
+    if (flashConfig.capture)
+        captureStart();
+    else
+        captureStop();
+    return 0;
+}
+
+int getCaptureDropped(void *data, char *value)
+{
+    capture_stats stats;
+
+    captureStats(&stats);
+    sprintf(value, "%u", (unsigned)stats.dropped);
+    return 0;
+}
+
+int getCaptureRate(void *data, char *value)
+{
+    capture_stats stats;
+
+    captureStats(&stats);
+    sprintf(value, "%u", (unsigned)stats.rate);
+    return 0;
+}
+
+int getUdpPeer(void *data, char *value)
+{
+    struct in_addr addr;
+
+    addr.s_addr = flashConfig.udp_peer_ip;
+    sprintf(value, "%s:%d", inet_ntoa(addr), (int)flashConfig.udp_peer_port);
+    return 0;
+}
+
+int setUdpPeer(void *data, char *value)
+{
+    return serbridgeSetPeer(value);
+}
+
 int setDbgBaudrate(void *data, char *value)
 {
     flashConfig.dbg_baud_rate = atoi(value);
@@ -18,6 +18,24 @@ int getMACAddress(void*, char*);
 int setMACAddress(void*, char*);
 int setBaudrate(void*, char*);
 int setDbgBaudrate(void*, char*);
+int getFraming(void*, char*);
+int setFraming(void*, char*);
+int getTransparent(void*, char*);
+int setTransparent(void*, char*);
+int getTxDepth(void*, char*);
+int getTxStall(void*, char*);
+int setFlowControl(void*, char*);
+int getUartOverruns(void*, char*);
+int getUartErrors(void*, char*);
+int getBridgeDepth(void*, char*);
+int getBridgeDropped(void*, char*);
+int getBridgeRatio(void*, char*);
+int getBridgeLzTime(void*, char*);
+int setCapture(void*, char*);
+int getCaptureDropped(void*, char*);
+int getCaptureRate(void*, char*);
+int getUdpPeer(void*, char*);
+int setUdpPeer(void*, char*);
 int setResetPin(void*, char*);
 int setLoaderBaudrate(void*, char*);
 int intGetHandler(void*, char*);
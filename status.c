@@ -14,6 +14,7 @@
 #include "freertos/event_groups.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "led_strip.h"
 #include "status.h"
@@ -30,6 +31,7 @@ static int s_retry_num = 0;
 static const char* TAG = "status";
 gpio_config_t io_conf;
 static led_strip_handle_t led_strip;
+static esp_timer_handle_t resetTimer;
 
 static void event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
@@ -174,6 +176,23 @@ void statusReset()
     gpio_set_level(flashConfig.reset_pin, 1);
 }
 
+static void statusRelease(void *arg)
+{
+    gpio_set_level(flashConfig.reset_pin, 1);
+}
+
+/**
+ * @brief pull reset and let a timer release it, for callers that cannot wait
+ */
+void statusResetAsync()
+{
+    if (esp_timer_is_active(resetTimer))
+        return;
+
+    gpio_set_level(flashConfig.reset_pin, 0);
+    esp_timer_start_once(resetTimer, 40 * 1000);
+}
+
 static void statusLoop(void* pvParameters)
 {
     int t;
@@ -317,6 +336,13 @@ void statusInit()
     gpio_set_direction(flashConfig.reset_pin, GPIO_MODE_OUTPUT);
     gpio_set_level(flashConfig.reset_pin, 1);
     ESP_LOGI(TAG, "Reset Pin %d, set", flashConfig.reset_pin);
+
+    esp_timer_create_args_t reset =
+    {
+        .callback = statusRelease,
+        .name = "reset"
+    };
+    esp_timer_create(&reset, &resetTimer);
     
 #ifdef CONFIG_STRIP
     led_strip_config_t strip_config = 
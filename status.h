@@ -15,4 +15,5 @@ void statusConnect(void);
 bool statusIsConnecting(void);
 int statusGet(void);
 void statusReset(void);
+void statusResetAsync(void);
 void waittoConnect(void);
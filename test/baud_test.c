@@ -0,0 +1,255 @@
+/**
+ * @file baud_test.c
+ * @brief rate switch over a simulated line, with a Propeller thread that
+ * follows the protocol in baud.h and faults injected on the way
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include "baud.h"
+
+#define OLD_RATE    115200
+#define REPLY_MS    100     // how long either side waits for a reply in the check after the switch
+
+static int failures;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: failed %s\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+// one direction of the line
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t buf[256];
+    int head, tail;
+} line;
+
+static line toEsp = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+static line toProp = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+static atomic_int espRate;
+static atomic_int propRate;
+
+// faults
+enum { FAULT_NONE, FAULT_PROBE, FAULT_ECHO, FAULT_CONFIRM };
+static int fault;
+
+
+/**
+ * @brief send bytes, garbled when the two ends are at different rates
+ */
+static void lineWrite(line *l, const uint8_t *buf, int len, int from, int to)
+{
+    pthread_mutex_lock(&l->lock);
+    for (int i = 0; i < len; i++)
+    {
+        l->buf[l->head++ % sizeof(l->buf)] = from == to ? buf[i] : buf[i] ^ 0x5A;
+    }
+    pthread_cond_broadcast(&l->cond);
+    pthread_mutex_unlock(&l->lock);
+}
+
+static int lineRead(line *l, uint8_t *buf, int len, int ms)
+{
+    struct timespec until;
+    int n = 0, err = 0;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += ms / 1000;
+    until.tv_nsec += (long)(ms % 1000) * 1000000;
+    if (until.tv_nsec >= 1000000000)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&l->lock);
+    while ((n < len) && (err != ETIMEDOUT))
+    {
+        if (l->tail != l->head)
+            buf[n++] = l->buf[l->tail++ % sizeof(l->buf)];
+        else
+            err = pthread_cond_timedwait(&l->cond, &l->lock, &until);
+    }
+    pthread_mutex_unlock(&l->lock);
+    return n;
+}
+
+static void lineFlush(line *l)
+{
+    pthread_mutex_lock(&l->lock);
+    l->tail = l->head;
+    pthread_mutex_unlock(&l->lock);
+}
+
+static void espSetRate(int rate)
+{
+    atomic_store(&espRate, rate);
+}
+
+static int espRead(uint8_t *buf, int len, int ms)
+{
+    return lineRead(&toEsp, buf, len, ms);
+}
+
+static void espWrite(const uint8_t *buf, int len)
+{
+    // the echo is the only thing the ESP sends during the switch
+    if (fault == FAULT_ECHO)
+        return;
+    lineWrite(&toProp, buf, len, atomic_load(&espRate), atomic_load(&propRate));
+}
+
+static void espFlush(void)
+{
+    lineFlush(&toEsp);
+}
+
+static const baud_link espLink = { espSetRate, espRead, espWrite, espFlush };
+
+static void propWrite(const uint8_t *buf, int len)
+{
+    lineWrite(&toEsp, buf, len, atomic_load(&propRate), atomic_load(&espRate));
+}
+
+/**
+ * @brief the Propeller side, started once the ack is on the line
+ */
+static void *propeller(void *arg)
+{
+    int to = *(int*)arg;
+    uint8_t buf[sizeof(baudProbe)];
+
+    usleep(BAUD_SETTLE_MS * 1000);
+    atomic_store(&propRate, to);
+
+    if (fault == FAULT_PROBE)
+    {
+        memcpy(buf, baudProbe, sizeof(buf));
+        buf[3] ^= 0x10;
+        propWrite(buf, sizeof(buf));
+    }
+    else
+    {
+        propWrite(baudProbe, sizeof(baudProbe));
+    }
+
+    if ((lineRead(&toProp, buf, sizeof(buf), BAUD_PROBE_MS) != sizeof(buf)) ||
+        (memcmp(buf, baudProbe, sizeof(buf)) != 0))
+    {
+        atomic_store(&propRate, OLD_RATE);
+        return NULL;
+    }
+
+    if (fault != FAULT_CONFIRM)
+        propWrite(baudConfirm, sizeof(baudConfirm));
+    return NULL;
+}
+
+/**
+ * @brief first command after the switch, a Propeller without an answer falls back
+ * @return true if the command was answered
+ */
+static bool ping(void)
+{
+    uint8_t buf[4];
+    bool answered;
+
+    propWrite((const uint8_t*)"PING", 4);
+    if ((espRead(buf, 4, REPLY_MS) == 4) && (memcmp(buf, "PING", 4) == 0))
+        lineWrite(&toProp, (const uint8_t*)"PONG", 4, atomic_load(&espRate), atomic_load(&propRate));
+
+    answered = (lineRead(&toProp, buf, 4, REPLY_MS) == 4) && (memcmp(buf, "PONG", 4) == 0);
+    if (!answered)
+        atomic_store(&propRate, OLD_RATE);
+
+    lineFlush(&toEsp);
+    lineFlush(&toProp);
+    return answered;
+}
+
+/**
+ * @brief one switch from OLD_RATE
+ * @param to new rate
+ * @param f fault to inject
+ * @return baudSwitch result
+ */
+static int run(int to, int f)
+{
+    pthread_t prop;
+    int err;
+
+    fault = f;
+    atomic_store(&espRate, OLD_RATE);
+    atomic_store(&propRate, OLD_RATE);
+    lineFlush(&toEsp);
+    lineFlush(&toProp);
+
+    // left over input at the old rate must not spoil the probe
+    propWrite((const uint8_t*)"stale", 5);
+
+    pthread_create(&prop, NULL, propeller, &to);
+    err = baudSwitch(&espLink, OLD_RATE, to);
+    pthread_join(prop, NULL);
+    return err;
+}
+
+static void testRates(void)
+{
+    static const int rates[] = { 115200, 921600, 2000000, 2500000, 3000000 };
+
+    for (int i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        CHECK(baudValid(rates[i]));
+        printf("%8d -> %8u\n", rates[i], (unsigned)baudActual(rates[i]));
+    }
+    CHECK(!baudValid(BAUD_MIN - 1));
+    CHECK(!baudValid(BAUD_MAX + 1));
+    CHECK(!baudValid(0));
+}
+
+static void testSwitch(void)
+{
+    CHECK(run(2000000, FAULT_NONE) == 0);
+    CHECK(atomic_load(&espRate) == 2000000);
+    CHECK(ping());
+    CHECK(atomic_load(&propRate) == 2000000);
+
+    CHECK(run(3000000, FAULT_NONE) == 0);
+    CHECK(atomic_load(&espRate) == 3000000);
+    CHECK(ping());
+    CHECK(atomic_load(&propRate) == 3000000);
+}
+
+static void testFaults(void)
+{
+    int f;
+
+    for (f = FAULT_PROBE; f <= FAULT_CONFIRM; f++)
+    {
+        CHECK(run(3000000, f) == -1);
+        CHECK(atomic_load(&espRate) == OLD_RATE);
+
+        // a lost confirm is only noticed by the Propeller on its next command
+        CHECK(ping() == (f != FAULT_CONFIRM));
+        CHECK(atomic_load(&propRate) == OLD_RATE);
+        CHECK(ping());
+    }
+}
+
+int main(void)
+{
+    testRates();
+    testSwitch();
+    testFaults();
+
+    printf("%s\n", failures == 0 ? "baud ok" : "baud FAILED");
+    return failures != 0;
+}
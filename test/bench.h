@@ -0,0 +1,64 @@
+/**
+ * @file bench.h
+ * @brief timing helpers shared by the host benchmarks
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Monotonic time
+ * @return nanoseconds
+ */
+static inline int64_t benchNow(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * @brief Cycle counter where the host has one
+ * @return cycles or 0
+ */
+static inline uint64_t benchCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Thread CPU time, for costs that sleeping would hide
+ * @return nanoseconds
+ */
+static inline int64_t benchCpu(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * @brief Process CPU time, for tasks the benchmark has no handle on
+ * @return nanoseconds
+ */
+static inline int64_t benchProcessCpu(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+#endif
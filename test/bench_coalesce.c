@@ -0,0 +1,286 @@
+/**
+ * @file bench_coalesce.c
+ * @brief segments, added latency and send cost of each bridge coalescing mode
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * Uart output is paced into the real serbridge.c, whose task queues it,
+ * arms the batch timer and sends to a loopback client exactly as on the
+ * chip. The client advertises an ethernet MSS so segments are cut as
+ * they would be on wifi. Latency is byte weighted from serbridgeSend to
+ * the client's recv, sends come from the bridge's latency histogram,
+ * segments from the client's TCP_INFO, and cpu is what the bridge and
+ * timer tasks used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/tcp.h>
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "serbridge.h"
+#include "config.h"
+#include "bench.h"
+
+#define BATCH       1460        // config.c BRIDGE_BATCH
+#define DELAY_US    2000        // config.c BRIDGE_DELAY
+#define MSS         1460
+#define SECONDS     2
+#define WAIT_MS     5000        // longest wait for the bridge task to act
+
+FlashConfig flashConfig;
+
+typedef struct
+{
+    const char *name;
+    int64_t gap;                // us between uart reads
+    int size;                   // bytes per read
+    bool line;                  // each read ends with a newline
+} workload;
+
+// one uart read, bytes before end arrived at time
+typedef struct
+{
+    int64_t end;
+    int64_t time;
+} arrival;
+
+static arrival *arrivals;
+static atomic_llong received;
+static double latency;          // sum over bytes of us from uart to client
+static int64_t readerCpu;
+static int port;
+
+
+int64_t esp_timer_get_time(void)
+{
+    return benchNow() / 1000;
+}
+
+/**
+ * @brief the client, charging each byte the time since its uart read
+ */
+static void *reader(void *arg)
+{
+    static char buf[65536];
+    int sock = *(int*)arg;
+    int64_t got, now, start, take;
+    int k, n;
+
+    start = benchCpu();
+    got = 0;
+    k = 0;
+    while ((n = recv(sock, buf, sizeof(buf), 0)) > 0)
+    {
+        now = esp_timer_get_time();
+        while (n > 0)
+        {
+            take = arrivals[k].end - got;
+            if (take > n)
+                take = n;
+            latency += (double)take * (now - arrivals[k].time);
+            got += take;
+            n -= take;
+            if (got == arrivals[k].end)
+                k++;
+        }
+        atomic_store(&received, got);
+    }
+    readerCpu = benchCpu() - start;
+    return NULL;
+}
+
+static int64_t sends(void)
+{
+    bridge_stats s;
+    int64_t n = 0;
+    int b;
+
+    serbridgeStats(&s);
+    for (b = 0; b < BRIDGE_LATENCY_BUCKETS; b++)
+        n += s.latency[b];
+    return n;
+}
+
+static uint32_t segments(int sock)
+{
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+
+    getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len);
+    return info.tcpi_segs_in;
+}
+
+static bool waitClients(uint32_t n)
+{
+    bridge_stats s;
+    int ms;
+
+    for (ms = 0; ms < WAIT_MS; ms++)
+    {
+        serbridgeStats(&s);
+        if (s.clients == n)
+            return true;
+        usleep(1000);
+    }
+    return false;
+}
+
+static int clientConnect(void)
+{
+    struct sockaddr_in addr;
+    int sock, mss = MSS, ms;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    for (ms = 0; ms < WAIT_MS; ms += 10)
+    {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(sock, IPPROTO_TCP, TCP_MAXSEG, &mss, sizeof(mss));
+        if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+            return sock;
+        close(sock);
+        usleep(10000);
+    }
+    return -1;
+}
+
+/**
+ * @brief pace one workload into the bridge for SECONDS
+ */
+static void run(const workload *w, int mode, const char *name)
+{
+    static char data[BRIDGE_QUEUE];
+    struct timespec next;
+    pthread_t client;
+    bridge_stats s;
+    int64_t total, sent, cpu, start, feederCpu;
+    uint32_t segs, dropped;
+    int sock, n, k, ms;
+
+    flashConfig.bridge_mode = mode;
+    memset(data, 'x', w->size);
+    data[w->size - 1] = w->line ? '\n' : 'x';
+
+    n = SECONDS * 1000000 / w->gap;
+    arrivals = malloc(n * sizeof(arrival));
+    atomic_store(&received, 0);
+    latency = 0;
+
+    sock = clientConnect();
+    if ((sock < 0) || !waitClients(1))
+    {
+        printf("%-13s %-12s no connection\n", w->name, name);
+        free(arrivals);
+        return;
+    }
+    pthread_create(&client, NULL, reader, &sock);
+
+    serbridgeStats(&s);
+    dropped = s.dropped;
+    sent = sends();
+    segs = segments(sock);
+    cpu = benchProcessCpu();
+    start = benchCpu();
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    total = 0;
+    for (k = 0; k < n; k++)
+    {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        total += w->size;
+        arrivals[k].end = total;
+        arrivals[k].time = esp_timer_get_time();
+        serbridgeSend(data, w->size);
+
+        next.tv_nsec += w->gap * 1000;
+        next.tv_sec += next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+    }
+    feederCpu = benchCpu() - start;
+
+    for (ms = 0; (ms < WAIT_MS) && (atomic_load(&received) < total); ms++)
+        usleep(1000);
+
+    // a send is counted once it returns, which can be after the client has it
+    usleep(10000);
+
+    sent = sends() - sent;
+    segs = segments(sock) - segs;
+    serbridgeStats(&s);
+
+    shutdown(sock, SHUT_RDWR);
+    pthread_join(client, NULL);
+    close(sock);
+    waitClients(0);
+
+    // the bridge and timer tasks are what is left of the process
+    cpu = benchProcessCpu() - cpu - feederCpu - readerCpu;
+
+    printf("%-13s %-12s %10.1f %10.1f %12.1f %12.1f", w->name, name,
+        (double)sent / SECONDS, (double)segs / SECONDS, latency / total, cpu / 1e3 / SECONDS);
+    if (atomic_load(&received) < total)
+        printf("  %lld bytes lost", (long long)(total - atomic_load(&received)));
+    if (s.dropped != dropped)
+        printf("  %u dropped", (unsigned)(s.dropped - dropped));
+    printf("\n");
+    free(arrivals);
+}
+
+static int freePort(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int sock;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    bind(sock, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(sock, (struct sockaddr*)&addr, &len);
+    close(sock);
+    return ntohs(addr.sin_port);
+}
+
+int main(void)
+{
+    static const workload loads[] = {
+        { "bulk 921600", 1302, 120, false },    // rx fifo fills every 120 bytes
+        { "lines 115200", 20000, 48, true },    // 50 telemetry lines a second
+        { "keys", 150000, 1, false },           // someone typing at a prompt
+    };
+    static const char *modes[] = { "interactive", "throughput", "line" };
+    int l, m;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    flashConfig.bridge_clients = 1;
+    flashConfig.bridge_policy = BRIDGE_DROP_OLDEST;
+    flashConfig.bridge_batch = BATCH;
+    flashConfig.bridge_delay = DELAY_US;
+    port = freePort();
+    serbridgeInit(port);
+
+    printf("%-13s %-12s %10s %10s %12s %12s\n", "workload", "mode", "sends/s", "segs/s", "latency us", "cpu us/s");
+    for (l = 0; l < sizeof(loads) / sizeof(loads[0]); l++)
+    {
+        for (m = BRIDGE_INTERACTIVE; m <= BRIDGE_LINE; m++)
+            run(&loads[l], m, modes[m]);
+    }
+
+    return 0;
+}
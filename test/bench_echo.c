@@ -0,0 +1,271 @@
+/**
+ * @file bench_echo.c
+ * @brief round trip from a bridge client through a simulated uart and back
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * A loopback client sends a byte to the real serbridge.c, whose task puts
+ * it in the telnet ring. A parser thread moves it to a simulated uart,
+ * a Propeller thread echoes it, and the parser hands the echo back to
+ * serbridgeSend for the bridge task to send. The uart takes a byte time
+ * each way at UART_BAUD, and the driver reports input RX_TIMEOUT symbols
+ * after the last byte as parserInit sets it up. The event parser sleeps
+ * on one semaphore given by the telnet ring and the uart, like the queue
+ * set in parserInit. The polling parser waits on the uart with the old
+ * 200 ms timeout and only then looks at the ring.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "serbridge.h"
+#include "parser.h"
+#include "config.h"
+#include "bench.h"
+
+#define POLL_MS         200     // receiveBytes timeout of the old loop
+#define EVENT_TRIPS     5000
+#define POLL_TRIPS      20
+#define UART_BAUD       115200
+#define RX_TIMEOUT      3       // uart_set_rx_timeout in parserInit
+#define BYTE_NS         (10 * 1000000000LL / UART_BAUD)
+#define WAIT_MS         5000    // longest wait for the bridge task to act
+
+FlashConfig flashConfig;
+
+static char uartTxData[1024];
+static char uartRxData[1024];
+static ring_t uartTx = RING_INIT(uartTxData);       // parser to Propeller
+static ring_t uartRx = RING_INIT(uartRxData);       // Propeller to parser
+static ring_t *inRing;                              // bridge to parser
+static SemaphoreHandle_t events;
+static volatile bool stop;
+static int port;
+
+
+int64_t esp_timer_get_time(void)
+{
+    return benchNow() / 1000;
+}
+
+/**
+ * @brief spend the time bytes take on the wire
+ */
+static void wire(int bytes)
+{
+    struct timespec t;
+
+    t.tv_sec = 0;
+    t.tv_nsec = bytes * BYTE_NS;
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &t, NULL);
+}
+
+/**
+ * @brief copy everything waiting in one ring to another
+ * @return bytes moved
+ */
+static int move(ring_t *from, ring_t *to)
+{
+    char *p;
+    int n, t = 0;
+
+    while ((n = ringPeek(from, &p)) > 0)
+    {
+        n = ringWrite(to, p, n);
+        ringConsume(from, n);
+        t += n;
+    }
+    return t;
+}
+
+/**
+ * @brief uart input going out to the bridge clients
+ */
+static void toClient(void)
+{
+    char *p;
+    int n;
+
+    while ((n = ringPeek(&uartRx, &p)) > 0)
+    {
+        serbridgeSend(p, n);
+        ringConsume(&uartRx, n);
+    }
+}
+
+static void *propeller(void *arg)
+{
+    char buf[sizeof(uartTxData)];
+    char *p;
+    int n;
+
+    while (!stop)
+    {
+        if (!xSemaphoreTake(uartTx.ready, 100))
+            continue;
+        while ((n = ringPeek(&uartTx, &p)) > 0)
+        {
+            memcpy(buf, p, n);
+            ringConsume(&uartTx, n);
+
+            // out to the Propeller, back, then the driver's idle timeout
+            wire(n);
+            wire(n + RX_TIMEOUT);
+            ringWrite(&uartRx, buf, n);
+        }
+    }
+    return NULL;
+}
+
+static void *eventParser(void *arg)
+{
+    while (!stop)
+    {
+        xSemaphoreTake(events, portMAX_DELAY);
+        toClient();
+        move(inRing, &uartTx);
+    }
+    return NULL;
+}
+
+static void *pollParser(void *arg)
+{
+    while (!stop)
+    {
+        xSemaphoreTake(uartRx.ready, POLL_MS);
+        toClient();
+        move(inRing, &uartTx);
+    }
+    return NULL;
+}
+
+static int compare(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static int clientConnect(void)
+{
+    struct sockaddr_in addr;
+    int sock, flag = 1, ms;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    for (ms = 0; ms < WAIT_MS; ms += 10)
+    {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+            return sock;
+        close(sock);
+        usleep(10000);
+    }
+    return -1;
+}
+
+static void run(const char *name, void *(*parser)(void*), int trips)
+{
+    pthread_t prop, task;
+    int64_t *rtt, start, total;
+    bridge_stats s;
+    char c;
+    int sock, i, ms;
+
+    stop = false;
+    events = xSemaphoreCreateBinary();
+    uartTx.ready = xSemaphoreCreateBinary();
+    inRing->ready = parser == eventParser ? events : NULL;
+    uartRx.ready = parser == eventParser ? events : xSemaphoreCreateBinary();
+
+    pthread_create(&prop, NULL, propeller, NULL);
+    pthread_create(&task, NULL, parser, NULL);
+
+    sock = clientConnect();
+    for (ms = 0; ms < WAIT_MS; ms++)
+    {
+        serbridgeStats(&s);
+        if (s.clients == 1)
+            break;
+        usleep(1000);
+    }
+
+    rtt = malloc(trips * sizeof(int64_t));
+    total = 0;
+    for (i = 0; i < trips; i++)
+    {
+        start = benchNow();
+        c = 'x';
+        if ((send(sock, &c, 1, 0) != 1) || (recv(sock, &c, 1, 0) != 1))
+        {
+            printf("%-6s connection lost after %d trips\n", name, i);
+            trips = i;
+            break;
+        }
+        rtt[i] = benchNow() - start;
+        total += rtt[i];
+    }
+    close(sock);
+
+    stop = true;
+    xSemaphoreGive(events);
+    xSemaphoreGive(uartRx.ready);
+    pthread_join(task, NULL);
+    pthread_join(prop, NULL);
+
+    if (trips > 0)
+    {
+        qsort(rtt, trips, sizeof(int64_t), compare);
+        printf("%-6s %6d trips  min %9.1f us  avg %9.1f us  p99 %9.1f us  max %9.1f us\n", name, trips,
+            rtt[0] / 1e3, total / 1e3 / trips, rtt[trips * 99 / 100] / 1e3, rtt[trips - 1] / 1e3);
+    }
+    free(rtt);
+}
+
+static int freePort(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int sock;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    bind(sock, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(sock, (struct sockaddr*)&addr, &len);
+    close(sock);
+    return ntohs(addr.sin_port);
+}
+
+int main(void)
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    flashConfig.bridge_clients = 1;
+    flashConfig.bridge_mode = BRIDGE_INTERACTIVE;
+    flashConfig.bridge_policy = BRIDGE_DROP_OLDEST;
+    inRing = receiveRing(RECEIVE_TELNET);
+    port = freePort();
+    serbridgeInit(port);
+
+    printf("uart %d baud, %.1f us per byte\n", UART_BAUD, BYTE_NS / 1e3);
+    run("event", eventParser, EVENT_TRIPS);
+    run("poll", pollParser, POLL_TRIPS);
+    return 0;
+}
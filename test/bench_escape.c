@@ -0,0 +1,152 @@
+/**
+ * @file bench_escape.c
+ * @brief overhead and speed of the transparent mode start token doubling
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * Encoding splits a buffer at each start token and doubles it, as
+ * sendEscaped does toward the Propeller. Decoding drops the second of
+ * each pair, as scanBlock does for data from the Propeller. Both work on
+ * whole runs between tokens, the byte loop is there for comparison.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "cmds.h"
+#include "scan.h"
+#include "bench.h"
+
+#define BLOCKSIZE   1024            // parser.c drain and scan block
+#define BENCH_BYTES (64 << 20)
+
+
+static int escapeRuns(char *in, int len, char *out)
+{
+    char *p;
+    int n, o = 0;
+
+    while (len > 0)
+    {
+        p = findStart(in, len);
+        n = (p == NULL) ? len : p - in + 1;
+        memcpy(&out[o], in, n);
+        o += n;
+        if (p != NULL)
+            out[o++] = TKN_START;
+        in += n;
+        len -= n;
+    }
+    return o;
+}
+
+static int escapeBytes(char *in, int len, char *out)
+{
+    int i, o = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        out[o++] = in[i];
+        if ((uint8_t)in[i] == TKN_START)
+            out[o++] = TKN_START;
+    }
+    return o;
+}
+
+static int unescapeRuns(char *in, int len, char *out)
+{
+    char *p;
+    int n, i = 0, o = 0;
+
+    while (i < len)
+    {
+        p = findStart(&in[i], len - i);
+        n = (p == NULL) ? len - i : p - &in[i] + 1;
+        memcpy(&out[o], &in[i], n);
+        o += n;
+        i += n;
+        if ((p != NULL) && (i < len) && ((uint8_t)in[i] == TKN_START))
+            i++;
+    }
+    return o;
+}
+
+static double rate(int64_t bytes, int64_t ns)
+{
+    return (double)bytes * 1000 / (ns > 0 ? ns : 1);
+}
+
+static void run(const char *name, char *data, int len)
+{
+    static char enc[2 * BLOCKSIZE], dec[BLOCKSIZE];
+    static char coded[2 << 20];
+    static int sizes[(1 << 20) / BLOCKSIZE + 1];
+    int64_t start, encodeNs, byteNs, decodeNs, total;
+    int i, b, r, rounds, n, blocks;
+
+    // code the data once in blocks and check the round trip
+    total = 0;
+    blocks = 0;
+    for (i = 0; i < len; i += BLOCKSIZE)
+    {
+        n = len - i < BLOCKSIZE ? len - i : BLOCKSIZE;
+        sizes[blocks] = escapeRuns(&data[i], n, &coded[total]);
+        if ((unescapeRuns(&coded[total], sizes[blocks], dec) != n) || (memcmp(dec, &data[i], n) != 0))
+        {
+            printf("%s: round trip failed at %d\n", name, i);
+            exit(1);
+        }
+        total += sizes[blocks++];
+    }
+
+    rounds = BENCH_BYTES / len + 1;
+
+    start = benchNow();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < len; i += BLOCKSIZE)
+            escapeRuns(&data[i], len - i < BLOCKSIZE ? len - i : BLOCKSIZE, enc);
+    encodeNs = benchNow() - start;
+
+    start = benchNow();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < len; i += BLOCKSIZE)
+            escapeBytes(&data[i], len - i < BLOCKSIZE ? len - i : BLOCKSIZE, enc);
+    byteNs = benchNow() - start;
+
+    start = benchNow();
+    for (r = 0; r < rounds; r++)
+        for (i = 0, b = 0; b < blocks; i += sizes[b++])
+            unescapeRuns(&coded[i], sizes[b], dec);
+    decodeNs = benchNow() - start;
+
+    printf("%-8s overhead %6.2f%%  encode %8.1f MB/s  byte loop %8.1f MB/s  decode %8.1f MB/s\n", name,
+        (double)(total - len) * 100 / len, rate((int64_t)rounds * len, encodeNs),
+        rate((int64_t)rounds * len, byteNs), rate((int64_t)rounds * len, decodeNs));
+}
+
+int main(void)
+{
+    static char data[1 << 20];
+    uint32_t x = 1;
+    int i, n;
+
+    // telemetry text never holds the token
+    n = 0;
+    for (i = 0; n < sizeof(data) - 64; i++)
+        n += sprintf(&data[n], "T=%d.%02d,P=%d,V=%d\r\n", i % 400, i % 100, 1000 + i % 37, i * 7 % 4096);
+    run("text", data, n);
+
+    for (i = 0; i < sizeof(data); i++)
+    {
+        x = x * 1103515245 + 12345;
+        data[i] = x >> 24;
+    }
+    run("binary", data, sizeof(data));
+
+    memset(data, TKN_START, sizeof(data));
+    run("worst", data, sizeof(data));
+
+    return 0;
+}
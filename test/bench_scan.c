@@ -0,0 +1,260 @@
+/**
+ * @file bench_scan.c
+ * @brief uart receive path, block scan against the old byte at a time loop
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * bench_scan [file ...] runs recorded serial streams, or synthetic ones
+ * when no file is given. Of a capture file only the received data is
+ * run. Both paths hand passthrough to the same sink and skip command
+ * lines to the '\r'.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmds.h"
+#include "capture.h"
+#include "scan.h"
+#include "bench.h"
+
+#define BLOCKSIZE   1024            // parser.c scan block
+#define BENCH_BYTES (64 << 20)      // every stream is run until this much has passed
+
+typedef struct
+{
+    const char *name;
+    char *data;
+    int len;
+} stream;
+
+static uint64_t sinkBytes;
+static uint64_t sinkCalls;
+static int streamPos;
+
+
+// stands in for serbridgeSend
+static __attribute__((noinline)) int sink(char *data, int len)
+{
+    sinkBytes += len;
+    sinkCalls++;
+    return len;
+}
+
+// stands in for uart_read_bytes out of the driver buffer
+static __attribute__((noinline)) int readUart(stream *s, char *buf, int len)
+{
+    if (len > s->len - streamPos)
+        len = s->len - streamPos;
+    memcpy(buf, &s->data[streamPos], len);
+    streamPos += len;
+    return len;
+}
+
+/**
+ * @brief the loop parserInit ran before blocks, one read and one send per byte
+ */
+static void byteLoop(stream *s)
+{
+    char outBuffer[1024];
+    bool parse = false;
+    int Out = 0;
+    char data;
+
+    streamPos = 0;
+    while (readUart(s, &data, 1) > 0)
+    {
+        if (parse && (data == '\r'))
+        {
+            Out = 0;
+            parse = false;
+            continue;
+        }
+        if (data == TKN_START)
+            parse = true;
+        if (Out < sizeof(outBuffer))
+            outBuffer[Out++] = data;
+        if ((Out > 0) && !parse)
+        {
+            sink(outBuffer, Out);
+            Out = 0;
+        }
+    }
+}
+
+/**
+ * @brief the block path, passthrough goes out as one slice per run
+ */
+static void blockLoop(stream *s)
+{
+    char rxBlock[BLOCKSIZE];
+    bool parse = false;
+    char *p, *e;
+    int head, tail;
+
+    streamPos = 0;
+    while ((tail = readUart(s, rxBlock, BLOCKSIZE)) > 0)
+    {
+        head = 0;
+        while (head < tail)
+        {
+            if (parse)
+            {
+                // command bytes still go through the token parser one by one
+                if (rxBlock[head++] == '\r')
+                    parse = false;
+                continue;
+            }
+            p = findStart(&rxBlock[head], tail - head);
+            e = (p == NULL) ? &rxBlock[tail] : p;
+            if (e > &rxBlock[head])
+                sink(&rxBlock[head], e - &rxBlock[head]);
+            head = e - rxBlock;
+            if (p != NULL)
+            {
+                parse = true;
+                head++;
+            }
+        }
+    }
+}
+
+static void run(stream *s, void (*loop)(stream*), const char *how)
+{
+    uint64_t cycles;
+    int64_t start, ns;
+    int i, rounds;
+
+    rounds = BENCH_BYTES / s->len + 1;
+    sinkBytes = 0;
+    sinkCalls = 0;
+    start = benchNow();
+    cycles = benchCycles();
+    for (i = 0; i < rounds; i++)
+        loop(s);
+    cycles = benchCycles() - cycles;
+    ns = benchNow() - start;
+
+    printf("%-10s %-6s %8.1f MB/s %6.2f ns/B", s->name, how, (double)rounds * s->len * 1000 / ns, (double)ns / rounds / s->len);
+    if (cycles != 0)
+        printf(" %6.2f cycles/B", (double)cycles / rounds / s->len);
+    printf(" %8.1f B/send\n", (double)sinkBytes / sinkCalls);
+}
+
+/**
+ * @brief telemetry lines with a command every few kilobytes
+ */
+static void makeText(stream *s)
+{
+    int n = 0, i = 0;
+
+    s->name = "text";
+    s->len = 1 << 20;
+    s->data = malloc(s->len);
+    while (n < s->len - 64)
+    {
+        n += sprintf(&s->data[n], "T=%d.%02d,P=%d,V=%d\r\n", i % 400, i % 100, 1000 + i % 37, i * 7 % 4096);
+        if (++i % 64 == 0)
+            n += sprintf(&s->data[n], "%c%c0,%d\r", TKN_START, TKN_POLL, i);
+    }
+    s->len = n;
+}
+
+/**
+ * @brief random binary, a start byte in every 256
+ */
+static void makeBinary(stream *s)
+{
+    uint32_t x = 1;
+    int i;
+
+    s->name = "binary";
+    s->len = 1 << 20;
+    s->data = malloc(s->len);
+    for (i = 0; i < s->len; i++)
+    {
+        x = x * 1103515245 + 12345;
+        s->data[i] = x >> 24;
+    }
+}
+
+/**
+ * @brief keep only the received data of capture records
+ * @param s stream holding a capture file
+ */
+static void captureData(stream *s)
+{
+    uint8_t *p = (uint8_t*)s->data;
+    int i, n, o;
+
+    i = 0;
+    o = 0;
+    while ((i + CAPTURE_HEADER <= s->len) && (p[i] == CAPTURE_MAGIC))
+    {
+        n = p[i + 6] | p[i + 7] << 8;
+        if (i + CAPTURE_HEADER + n > s->len)
+            break;
+        if (p[i + 1] == CAPTURE_RX)
+        {
+            memmove(&s->data[o], &s->data[i + CAPTURE_HEADER], n);
+            o += n;
+        }
+        i += CAPTURE_HEADER + n;
+    }
+    s->len = o;
+}
+
+static int loadFile(stream *s, const char *name)
+{
+    FILE *f;
+    long len;
+
+    f = fopen(name, "rb");
+    if (f == NULL)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    s->name = name;
+    s->data = malloc(len > 0 ? len : 1);
+    s->len = fread(s->data, 1, len, f);
+    fclose(f);
+
+    if ((s->len > 0) && ((uint8_t)s->data[0] == CAPTURE_MAGIC))
+        captureData(s);
+
+    return s->len > 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    stream s;
+    int i;
+
+    if (argc < 2)
+    {
+        makeText(&s);
+        run(&s, byteLoop, "byte");
+        run(&s, blockLoop, "block");
+        makeBinary(&s);
+        run(&s, byteLoop, "byte");
+        run(&s, blockLoop, "block");
+        return 0;
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if (loadFile(&s, argv[i]) != 0)
+        {
+            printf("Unable to read %s\n", argv[i]);
+            return 1;
+        }
+        run(&s, byteLoop, "byte");
+        run(&s, blockLoop, "block");
+    }
+
+    return 0;
+}
@@ -0,0 +1,372 @@
+/**
+ * @file bridge_test.c
+ * @brief bridge clients that vanish mid-stream, against the real serbridge.c
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * The bridge task runs as on the chip and loopback sockets play the
+ * clients. A client resets its connection with output still queued,
+ * stops reading without closing, or goes quiet, and each time the slot
+ * has to come free for the next client and the drop has to be reported.
+ * The bridge clock can be moved forward so keepalive and idle limits
+ * pass without waiting for them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "serbridge.h"
+#include "config.h"
+
+#define WAIT_MS     5000    // longest wait for the bridge task to act
+#define CHUNK       1024
+#define FILL_MS     200     // no output sent this long means the client's socket is full
+
+FlashConfig flashConfig;
+
+static int failures;
+static int port;
+static atomic_llong skew;
+static int logFd;
+static off_t logStart;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: failed %s\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000 + atomic_load(&skew);
+}
+
+/**
+ * @brief move the bridge clock forward
+ * @param s seconds
+ */
+static void advance(int s)
+{
+    atomic_fetch_add(&skew, (int64_t)s * 1000000);
+}
+
+/**
+ * @brief start looking for log lines from here on
+ */
+static void logMark(void)
+{
+    struct stat st;
+
+    fflush(stderr);
+    fstat(logFd, &st);
+    logStart = st.st_size;
+}
+
+/**
+ * @brief whether the bridge logged text since logMark
+ */
+static bool logged(const char *text)
+{
+    char buf[8192];
+    struct stat st;
+    ssize_t n;
+
+    fflush(stderr);
+    fstat(logFd, &st);
+    n = st.st_size - logStart;
+    if (n > sizeof(buf) - 1)
+        n = sizeof(buf) - 1;
+    n = pread(logFd, buf, n, logStart);
+    buf[n > 0 ? n : 0] = 0;
+    return strstr(buf, text) != NULL;
+}
+
+static bridge_stats stats(void)
+{
+    bridge_stats s;
+
+    serbridgeStats(&s);
+    return s;
+}
+
+/**
+ * @brief wait for the bridge to hold a number of clients
+ * @return true if it did in time
+ */
+static bool waitClients(uint32_t n)
+{
+    int ms;
+
+    for (ms = 0; ms < WAIT_MS; ms += 10)
+    {
+        if (stats().clients == n)
+            return true;
+        usleep(10000);
+    }
+    return false;
+}
+
+/**
+ * @param rcvbuf receive buffer, 0 for the default
+ * @return connected socket or -1
+ */
+static int clientConnect(int rcvbuf)
+{
+    struct sockaddr_in addr;
+    int sock, ms;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    // the bridge task may not be listening yet
+    for (ms = 0; ms < WAIT_MS; ms += 10)
+    {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (rcvbuf > 0)
+            setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+            return sock;
+        close(sock);
+        usleep(10000);
+    }
+    return -1;
+}
+
+/**
+ * @brief the client reads what the bridge sends it
+ * @return true if text arrived
+ */
+static bool clientGets(int sock, const char *text)
+{
+    struct timeval wait = { WAIT_MS / 1000, 0 };
+    char buf[64];
+    int n, r, len;
+
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+    len = strlen(text);
+    for (n = 0; n < len; n += r)
+    {
+        r = recv(sock, &buf[n], len - n, 0);
+        if (r <= 0)
+            return false;
+    }
+    return memcmp(buf, text, len) == 0;
+}
+
+/**
+ * @brief the only slot serves a new client once the old one is gone
+ */
+static void checkSlotFree(void)
+{
+    int sock;
+
+    sock = clientConnect(0);
+    CHECK(sock >= 0);
+    CHECK(waitClients(1));
+    serbridgeSend("next", 4);
+    CHECK(clientGets(sock, "next"));
+
+    // an orderly close is not an error
+    logMark();
+    close(sock);
+    CHECK(waitClients(0));
+    CHECK(!logged("Error occurred"));
+}
+
+/**
+ * @brief queue output until the client's socket takes no more
+ * @return true once nothing has been sent for FILL_MS with output queued
+ */
+static bool fill(void)
+{
+    static char data[CHUNK];
+    bridge_stats s;
+    uint32_t out;
+    int ms, quiet;
+
+    out = stats().tcpOut;
+    quiet = 0;
+    for (ms = 1; ms < WAIT_MS; ms++)
+    {
+        serbridgeSend(data, sizeof(data));
+        usleep(1000);
+        if (ms % 10 != 0)
+            continue;
+
+        s = stats();
+        quiet = (s.tcpOut == out) && (s.depth > 0) ? quiet + 10 : 0;
+        if (quiet >= FILL_MS)
+            return true;
+        out = s.tcpOut;
+    }
+    return false;
+}
+
+static void testReset(void)
+{
+    struct linger hard = { 1, 0 };
+    static char data[CHUNK];
+    uint32_t closes;
+    int sock, i;
+
+    sock = clientConnect(0);
+    CHECK(sock >= 0);
+    CHECK(waitClients(1));
+    closes = stats().closes;
+
+    serbridgeSend("start", 5);
+    CHECK(clientGets(sock, "start"));
+
+    // output still on its way when the peer resets
+    logMark();
+    for (i = 0; i < 8; i++)
+        serbridgeSend(data, sizeof(data));
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, &hard, sizeof(hard));
+    close(sock);
+
+    CHECK(waitClients(0));
+    CHECK(stats().closes == closes + 1);
+    CHECK(logged("Error occurred during"));
+    checkSlotFree();
+}
+
+static void testStall(void)
+{
+    uint32_t closes;
+    int sock;
+
+    // the peer is gone without a word, nothing it was sent is acknowledged
+    sock = clientConnect(4096);
+    CHECK(sock >= 0);
+    CHECK(waitClients(1));
+    closes = stats().closes;
+
+    logMark();
+    CHECK(fill());
+    CHECK(stats().clients == 1);
+
+    advance(flashConfig.keep_idle + flashConfig.keep_interval * flashConfig.keep_count + 1);
+    CHECK(waitClients(0));
+    CHECK(stats().closes == closes + 1);
+    CHECK(logged("Dropping stalled client"));
+    close(sock);
+    checkSlotFree();
+}
+
+static void testIdle(void)
+{
+    uint32_t closes;
+    int sock;
+
+    flashConfig.bridge_idle = 5;
+    sock = clientConnect(0);
+    CHECK(sock >= 0);
+    CHECK(waitClients(1));
+    closes = stats().closes;
+
+    // swept at least once short of the limit
+    logMark();
+    advance(2);
+    usleep(BRIDGE_SWEEP_MS * 1200);
+    CHECK(stats().clients == 1);
+
+    advance(3);
+    CHECK(waitClients(0));
+    CHECK(stats().closes == closes + 1);
+    CHECK(logged("Dropping idle client"));
+    flashConfig.bridge_idle = 0;
+    close(sock);
+    checkSlotFree();
+}
+
+static void testTakeover(void)
+{
+    uint32_t connects;
+    int gone, sock, ms;
+
+    // a vanished client holds the only slot until the next one takes it
+    flashConfig.bridge_takeover = 1;
+    gone = clientConnect(4096);
+    CHECK(gone >= 0);
+    CHECK(waitClients(1));
+    connects = stats().connects;
+
+    logMark();
+    sock = clientConnect(0);
+    CHECK(sock >= 0);
+    for (ms = 0; (ms < WAIT_MS) && (stats().connects == connects); ms += 10)
+        usleep(10000);
+    CHECK(stats().connects == connects + 1);
+    CHECK(stats().clients == 1);
+    CHECK(logged("Taking over from"));
+
+    serbridgeSend("mine", 4);
+    CHECK(clientGets(sock, "mine"));
+    flashConfig.bridge_takeover = 0;
+    close(gone);
+    close(sock);
+    CHECK(waitClients(0));
+}
+
+/**
+ * @brief a free port for the bridge to listen on
+ */
+static int freePort(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int sock;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    bind(sock, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(sock, (struct sockaddr*)&addr, &len);
+    close(sock);
+    return ntohs(addr.sin_port);
+}
+
+int main(void)
+{
+    FILE *log;
+
+    // lwIP has no SIGPIPE, a send to a reset socket just fails
+    signal(SIGPIPE, SIG_IGN);
+
+    // the bridge reports drops in its log
+    log = tmpfile();
+    logFd = fileno(log);
+    dup2(logFd, STDERR_FILENO);
+
+    flashConfig.bridge_clients = 1;
+    flashConfig.bridge_mode = BRIDGE_INTERACTIVE;
+    flashConfig.bridge_policy = BRIDGE_DROP_OLDEST;
+    flashConfig.bridge_batch = 1460;
+    flashConfig.bridge_delay = 2000;
+    flashConfig.keep_idle = 1;
+    flashConfig.keep_interval = 1;
+    flashConfig.keep_count = 1;
+
+    port = freePort();
+    serbridgeInit(port);
+
+    testReset();
+    testStall();
+    testIdle();
+    testTakeover();
+
+    printf("%s\n", failures == 0 ? "bridge ok" : "bridge FAILED");
+    return failures != 0;
+}
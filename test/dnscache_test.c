@@ -0,0 +1,151 @@
+/**
+ * @file dnscache_test.c
+ * @brief failure cache checked against a stub resolver that counts queries
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "dnscache.h"
+
+static int failures;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: failed %s\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+static int64_t now;
+static int queries;
+
+
+int64_t esp_timer_get_time(void)
+{
+    return now;
+}
+
+// names starting with "bad" do not resolve
+static int stubResolve(const char *host, uint32_t *addr)
+{
+    queries++;
+    if (strncmp(host, "bad", 3) == 0)
+        return -1;
+    *addr = 0x0100007f;
+    return 0;
+}
+
+static int lookup(const char *host)
+{
+    uint32_t addr = 0;
+
+    return dnsCacheLookup(host, &addr);
+}
+
+static void testAnswers(void)
+{
+    uint32_t addr = 0;
+
+    // answers are left to lwIP's own table, every lookup reaches the resolver
+    queries = 0;
+    CHECK(dnsCacheLookup("good.example", &addr) == 0);
+    CHECK(addr == 0x0100007f);
+    CHECK(lookup("good.example") == 0);
+    CHECK(queries == 2);
+}
+
+static void testFailures(void)
+{
+    queries = 0;
+    CHECK(lookup("bad.example") == -1);
+    CHECK(queries == 1);
+
+    // the failure is remembered until DNS_NEGATIVE_TTL_S has passed
+    now += (DNS_NEGATIVE_TTL_S - 1) * 1000000LL;
+    CHECK(lookup("bad.example") == -1);
+    CHECK(queries == 1);
+    now += 2 * 1000000LL;
+    CHECK(lookup("bad.example") == -1);
+    CHECK(queries == 2);
+}
+
+static void testLongNames(void)
+{
+    char name[DNS_CACHE_NAME + 8];
+
+    memset(name, 'b', sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+    memcpy(name, "bad", 3);
+
+    queries = 0;
+    CHECK(lookup(name) == -1);
+    CHECK(lookup(name) == -1);
+    CHECK(queries == 2);
+}
+
+static void testEviction(void)
+{
+    dns_cache_stats stats;
+    char name[16];
+    int i;
+
+    dnsCacheFlush();
+    queries = 0;
+    for (i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        sprintf(name, "bad%d", i);
+        lookup(name);
+        now += 1000;
+    }
+
+    // bad0 is the least used once bad1 on are hit again
+    for (i = 1; i < DNS_CACHE_ENTRIES; i++)
+    {
+        sprintf(name, "bad%d", i);
+        lookup(name);
+        now += 1000;
+    }
+    CHECK(queries == DNS_CACHE_ENTRIES);
+
+    dnsCacheStats(&stats);
+    CHECK(stats.evictions == 0);
+    lookup("badnew");
+    dnsCacheStats(&stats);
+    CHECK(stats.evictions == 1);
+    CHECK(queries == DNS_CACHE_ENTRIES + 1);
+
+    lookup("bad1");
+    CHECK(queries == DNS_CACHE_ENTRIES + 1);
+    lookup("bad0");
+    CHECK(queries == DNS_CACHE_ENTRIES + 2);
+}
+
+static void testCounters(void)
+{
+    dns_cache_stats stats;
+
+    dnsCacheInit(stubResolve);
+    lookup("good.example");
+    lookup("bad.example");
+    lookup("bad.example");
+    lookup("bad.example");
+
+    dnsCacheStats(&stats);
+    CHECK(stats.lookups == 4);
+    CHECK(stats.resolves == 2);
+    CHECK(stats.negativeHits == 2);
+    CHECK(stats.evictions == 0);
+}
+
+int main(void)
+{
+    now = 1000000;
+    dnsCacheInit(stubResolve);
+
+    testAnswers();
+    testFailures();
+    testLongNames();
+    testEviction();
+    testCounters();
+
+    printf("%s\n", failures == 0 ? "dnscache ok" : "dnscache FAILED");
+    return failures != 0;
+}
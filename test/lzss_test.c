@@ -0,0 +1,106 @@
+/**
+ * @file lzss_test.c
+ * @brief round trip of the bridge compressor over streams of blocks
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "lzss.h"
+
+#define STREAM  (256 * 1024)
+
+static int failures;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: failed %s\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+static uint8_t plain[STREAM];
+static uint8_t coded[4 * STREAM];      // one byte blocks take four each
+
+
+/**
+ * @brief code a stream in blocks of varying size, decode it and compare
+ * @param name for the report
+ * @param len bytes of plain
+ */
+static void roundTrip(const char *name, int len)
+{
+    static lzss_encoder z;
+    static lzss_decoder d;
+    uint8_t out[LZSS_BLOCK];
+    uint32_t state = 7;
+    int i, o, n, used, got, block;
+
+    lzssInit(&z);
+    o = 0;
+    for (i = 0; i < len; i += n)
+    {
+        // sizes from one byte to a full block keep the history moving unevenly
+        state = state * 1103515245 + 12345;
+        n = 1 + (state >> 16) % LZSS_BLOCK;
+        if (n > len - i)
+            n = len - i;
+        block = lzssEncode(&z, &plain[i], n, &coded[o]);
+        CHECK(block <= LZSS_BOUND(n));
+        o += block;
+    }
+
+    lzssDecodeInit(&d);
+    got = 0;
+    for (i = 0; i < o; i += used)
+    {
+        // a block cut short is not decoded and leaves the history alone
+        CHECK(lzssDecode(&d, &coded[i], 1, out, &used) == -1);
+        n = lzssDecode(&d, &coded[i], o - i, out, &used);
+        if (n < 0)
+        {
+            printf("%s: bad block at %d\n", name, i);
+            failures++;
+            return;
+        }
+        if (memcmp(out, &plain[got], n) != 0)
+        {
+            printf("%s: mismatch in the block at %d\n", name, got);
+            failures++;
+            return;
+        }
+        got += n;
+    }
+    CHECK(got == len);
+
+    printf("%-8s %7d -> %7d bytes, %5.1f%%\n", name, len, o, o * 100.0 / len);
+}
+
+int main(void)
+{
+    uint32_t x = 1;
+    int i, n;
+
+    n = 0;
+    for (i = 0; n < STREAM - 64; i++)
+        n += sprintf((char*)&plain[n], "T=%d.%02d,P=%d,V=%d\r\n", i % 400, i % 100, 1000 + i % 37, i * 7 % 4096);
+    roundTrip("text", n);
+
+    for (i = 0; i < STREAM; i++)
+    {
+        x = x * 1103515245 + 12345;
+        plain[i] = x >> 24;
+    }
+    roundTrip("random", STREAM);
+
+    memset(plain, 0, STREAM);
+    roundTrip("zeros", STREAM);
+
+    // matches that reach back the whole window
+    for (i = 0; i < STREAM; i++)
+        plain[i] = (i % (LZSS_WINDOW - 1)) * 31;
+    roundTrip("window", STREAM);
+
+    roundTrip("one", 1);
+
+    printf("%s\n", failures == 0 ? "lzss ok" : "lzss FAILED");
+    return failures != 0;
+}
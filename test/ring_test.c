@@ -0,0 +1,225 @@
+/**
+ * @file ring_test.c
+ * @brief ring checks, then a producer and a consumer thread through a small ring
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "ring.h"
+
+#define STRESS_BYTES    (64 * 1024 * 1024)
+#define STRESS_CHUNK    700     // largest write or read, not a divisor of the ring
+#define STRESS_WAIT_MS  1000    // a wakeup that takes longer was missed
+
+static int failures;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: failed %s\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+static char smallData[16];
+static char stressData[4096];
+static ring_t stressRing = RING_INIT(stressData);
+static SemaphoreHandle_t stressSpace;
+static int spaceCalls;
+
+
+static uint8_t pattern(uint32_t i)
+{
+    return (i * 2654435761u) >> 24;
+}
+
+static uint32_t next(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void countSpace(void *arg)
+{
+    spaceCalls++;
+}
+
+static void giveSpace(void *arg)
+{
+    xSemaphoreGive(arg);
+}
+
+/**
+ * @brief occupancy, wrap around, peeks and the stall callback on one thread
+ */
+static void testBasic(void)
+{
+    ring_t r = RING_INIT(smallData);
+    char in[16], out[16];
+    char *p;
+    int i, n;
+
+    r.space = countSpace;
+    for (i = 0; i < sizeof(in); i++)
+        in[i] = i;
+
+    CHECK(ringUsed(&r) == 0);
+    CHECK(ringFree(&r) == 16);
+    CHECK(ringWrite(&r, in, 10) == 10);
+    CHECK(ringUsed(&r) == 10);
+    CHECK(ringPeek(&r, &p) == 10);
+    CHECK(memcmp(p, in, 10) == 0);
+    ringConsume(&r, 8);
+    CHECK(spaceCalls == 0);
+
+    // 12 more wrap, a peek stops at the end of the array
+    CHECK(ringWrite(&r, &in[4], 12) == 12);
+    CHECK(ringUsed(&r) == 14);
+    CHECK(r.high == 14);
+    n = ringPeek(&r, &p);
+    CHECK(n == 8);
+    memcpy(out, p, n);
+    ringConsume(&r, n);
+    n += ringPeek(&r, &p);
+    CHECK(n == 14);
+    memcpy(&out[8], p, n - 8);
+    CHECK(memcmp(out, &in[8], 2) == 0);
+    CHECK(memcmp(&out[2], &in[4], 12) == 0);
+    ringConsume(&r, n - 8);
+
+    // a full ring stalls once however often the producer looks
+    CHECK(ringWrite(&r, in, 16) == 16);
+    CHECK(ringWrite(&r, in, 1) == 0);
+    CHECK(ringWriteSpace(&r, &p) == 0);
+    CHECK(ringStall(&r));
+    CHECK(ringStall(&r));
+    CHECK(r.stalls == 1);
+    ringConsume(&r, 1);
+    CHECK(spaceCalls == 1);
+    ringConsume(&r, 1);
+    CHECK(spaceCalls == 1);
+    CHECK(!ringStall(&r));
+    CHECK(r.stalls == 1);
+}
+
+static void *producer(void *arg)
+{
+    uint32_t state = 0x12345678;
+    uint32_t sent = 0;
+    char chunk[STRESS_CHUNK];
+    char *p;
+    int len, n, i;
+
+    while (sent < STRESS_BYTES)
+    {
+        len = 1 + next(&state) % STRESS_CHUNK;
+        if (len > STRESS_BYTES - sent)
+            len = STRESS_BYTES - sent;
+
+        // alternate copying in and filling in place
+        if (len & 1)
+        {
+            n = ringWriteSpace(&stressRing, &p);
+            if (n > len)
+                n = len;
+            for (i = 0; i < n; i++)
+                p[i] = pattern(sent + i);
+            if (n > 0)
+                ringCommit(&stressRing, n);
+        }
+        else
+        {
+            for (i = 0; i < len; i++)
+                chunk[i] = pattern(sent + i);
+            n = ringWrite(&stressRing, chunk, len);
+        }
+        sent += n;
+
+        if ((n == 0) && ringStall(&stressRing) && !xSemaphoreTake(stressSpace, STRESS_WAIT_MS))
+        {
+            printf("producer missed a wakeup at %u\n", sent);
+            failures++;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    uint32_t state = 0x9abcdef0;
+    uint32_t got = 0;
+    char *p;
+    int len, n, i;
+
+    while (got < STRESS_BYTES)
+    {
+        n = ringPeek(&stressRing, &p);
+        if (n == 0)
+        {
+            if (!xSemaphoreTake(stressRing.ready, STRESS_WAIT_MS))
+            {
+                printf("consumer missed a wakeup at %u\n", got);
+                failures++;
+                break;
+            }
+            continue;
+        }
+
+        len = 1 + next(&state) % STRESS_CHUNK;
+        if (len > n)
+            len = n;
+        for (i = 0; i < len; i++)
+        {
+            if ((uint8_t)p[i] != pattern(got + i))
+            {
+                printf("byte %u is %02x, expected %02x\n", got + i, (uint8_t)p[i], pattern(got + i));
+                failures++;
+                return NULL;
+            }
+        }
+        ringConsume(&stressRing, len);
+        got += len;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief push STRESS_BYTES through the ring with both sides sleeping when they cannot move
+ */
+static void testStress(void)
+{
+    pthread_t prod, cons;
+    struct timespec start, end;
+    double secs;
+
+    stressSpace = xSemaphoreCreateBinary();
+    stressRing.ready = xSemaphoreCreateBinary();
+    stressRing.space = giveSpace;
+    stressRing.spaceArg = stressSpace;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&cons, NULL, consumer, NULL);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    CHECK(ringUsed(&stressRing) == 0);
+    CHECK(stressRing.high <= stressRing.size);
+    printf("%d MB in %.2f s, %.1f MB/s, high %u, stalls %u\n", STRESS_BYTES >> 20, secs,
+        STRESS_BYTES / secs / 1e6, stressRing.high, stressRing.stalls);
+}
+
+int main(void)
+{
+    testBasic();
+    testStress();
+
+    printf("%s\n", failures == 0 ? "ring ok" : "ring FAILED");
+    return failures != 0;
+}
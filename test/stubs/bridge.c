@@ -0,0 +1,40 @@
+/**
+ * @file bridge.c
+ * @brief the parser and status calls serbridge.c makes, with no uart behind them
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * Client input lands in the telnet ring, where a test or benchmark can
+ * take it as the parser would.
+ */
+
+#include <stdbool.h>
+#include "parser.h"
+#include "status.h"
+
+#define HOST_BAUD   115200
+
+static char telnetData[4096];
+static char wsData[4096];
+static ring_t rings[RECEIVE_SOURCES] = { RING_INIT(telnetData), RING_INIT(wsData) };
+
+
+ring_t *receiveRing(int source)
+{
+    return &rings[source];
+}
+
+int parserRequestBaud(int rate)
+{
+    return rate;
+}
+
+int parserBaudRate(void)
+{
+    return HOST_BAUD;
+}
+
+void statusResetAsync(void)
+{
+}
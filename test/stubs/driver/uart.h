@@ -0,0 +1,23 @@
+/**
+ * @file uart.h
+ * @brief the uart calls the bridge makes, with nothing behind them
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef UART_H
+#define UART_H
+
+#include "esp_err.h"
+
+typedef int uart_port_t;
+
+#define UART_NUM_0  0
+
+static inline esp_err_t uart_flush_input(uart_port_t uart)
+{
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file esp_err.h
+ * @brief host error codes
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK      0
+#define ESP_FAIL    -1
+
+#endif
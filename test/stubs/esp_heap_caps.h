@@ -0,0 +1,26 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief the host heap, without PSRAM
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+
+static inline size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return 0;
+}
+
+static inline void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+#endif
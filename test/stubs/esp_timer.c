@@ -0,0 +1,143 @@
+/**
+ * @file esp_timer.c
+ * @brief host one-shot timers on a thread of their own
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "esp_timer.h"
+
+#define TIMER_MAX   8
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t due;
+    bool active;
+};
+
+static struct esp_timer *timers[TIMER_MAX];
+static int timerCount;
+static pthread_mutex_t timerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timerCond = PTHREAD_COND_INITIALIZER;
+static pthread_t timerThread;
+
+
+/**
+ * @brief run due callbacks without the lock, sleep until the next
+ */
+static void *timerTask(void *arg)
+{
+    struct esp_timer *next;
+    struct timespec until;
+    int64_t now, wait;
+    int i;
+
+    pthread_mutex_lock(&timerLock);
+    while (true)
+    {
+        next = NULL;
+        for (i = 0; i < timerCount; i++)
+        {
+            if (timers[i]->active && ((next == NULL) || (timers[i]->due < next->due)))
+                next = timers[i];
+        }
+
+        if (next == NULL)
+        {
+            pthread_cond_wait(&timerCond, &timerLock);
+            continue;
+        }
+
+        now = esp_timer_get_time();
+        if (next->due <= now)
+        {
+            next->active = false;
+            pthread_mutex_unlock(&timerLock);
+            next->callback(next->arg);
+            pthread_mutex_lock(&timerLock);
+            continue;
+        }
+
+        // deadlines are on the test's clock, which runs at real speed
+        wait = next->due - now;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += wait / 1000000;
+        until.tv_nsec += (wait % 1000000) * 1000;
+        if (until.tv_nsec >= 1000000000)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&timerCond, &timerLock, &until);
+    }
+
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer)
+{
+    struct esp_timer *t;
+
+    pthread_mutex_lock(&timerLock);
+    if ((timerCount == TIMER_MAX) || ((t = calloc(1, sizeof(struct esp_timer))) == NULL))
+    {
+        pthread_mutex_unlock(&timerLock);
+        return ESP_FAIL;
+    }
+    t->callback = args->callback;
+    t->arg = args->arg;
+    timers[timerCount++] = t;
+
+    if (timerCount == 1)
+    {
+        pthread_create(&timerThread, NULL, timerTask, NULL);
+        pthread_setname_np(timerThread, "esp_timer");
+    }
+    pthread_mutex_unlock(&timerLock);
+
+    *timer = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout)
+{
+    pthread_mutex_lock(&timerLock);
+    if (timer->active)
+    {
+        pthread_mutex_unlock(&timerLock);
+        return ESP_FAIL;
+    }
+    timer->due = esp_timer_get_time() + timeout;
+    timer->active = true;
+    pthread_cond_signal(&timerCond);
+    pthread_mutex_unlock(&timerLock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timerLock);
+    timer->active = false;
+    pthread_mutex_unlock(&timerLock);
+
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    bool active;
+
+    pthread_mutex_lock(&timerLock);
+    active = timer->active;
+    pthread_mutex_unlock(&timerLock);
+
+    return active;
+}
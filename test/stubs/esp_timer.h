@@ -0,0 +1,45 @@
+/**
+ * @file esp_timer.h
+ * @brief host clock and one-shot timers, each test supplies esp_timer_get_time
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+
+/**
+ * @brief Create a timer, callbacks run on one timer thread as on the chip
+ * @param args callback and argument
+ * @param timer returns the timer
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer);
+
+/**
+ * @brief Fire once, timeout us of esp_timer_get_time from now
+ */
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout);
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+#endif
@@ -0,0 +1,27 @@
+/**
+ * @file esp_vfs_eventfd.h
+ * @brief the host eventfd needs no registering
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef ESP_VFS_EVENTFD_H
+#define ESP_VFS_EVENTFD_H
+
+#include <sys/eventfd.h>
+#include "esp_err.h"
+
+typedef struct
+{
+    size_t max_fds;
+} esp_vfs_eventfd_config_t;
+
+#define ESP_VFS_EVENTD_CONFIG_DEFAULT() { .max_fds = 5 }
+
+static inline esp_err_t esp_vfs_eventfd_register(const esp_vfs_eventfd_config_t *config)
+{
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,16 @@
+/**
+ * @file esp_wifi.h
+ * @brief only the types the bridge headers need from the wifi driver
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+#endif
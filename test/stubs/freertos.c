@@ -0,0 +1,141 @@
+/**
+ * @file freertos.c
+ * @brief host semaphores and tasks over pthreads
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+struct host_sem
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;                  // 0 or 1
+};
+
+
+static SemaphoreHandle_t semCreate(int count)
+{
+    SemaphoreHandle_t s;
+
+    s = malloc(sizeof(struct host_sem));
+    if (s == NULL)
+        return NULL;
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = count;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semCreate(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semCreate(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait)
+{
+    struct timespec until;
+    int err = 0;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += wait / 1000;
+    until.tv_nsec += (long)(wait % 1000) * 1000000;
+    if (until.tv_nsec >= 1000000000)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while ((s->count == 0) && (err != ETIMEDOUT))
+    {
+        if (wait == portMAX_DELAY)
+            pthread_cond_wait(&s->cond, &s->lock);
+        else
+            err = pthread_cond_timedwait(&s->cond, &s->lock, &until);
+    }
+    if (s->count == 0)
+    {
+        pthread_mutex_unlock(&s->lock);
+        return pdFALSE;
+    }
+    s->count = 0;
+    pthread_mutex_unlock(&s->lock);
+
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->count = 1;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    return pdTRUE;
+}
+
+typedef struct
+{
+    TaskFunction_t fn;
+    void *arg;
+} host_start;
+
+static void *taskStart(void *arg)
+{
+    host_start start = *(host_start*)arg;
+
+    free(arg);
+    start.fn(start.arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, int priority, TaskHandle_t *task)
+{
+    host_start *start;
+    pthread_t thread;
+
+    start = malloc(sizeof(host_start));
+    if (start == NULL)
+        return pdFAIL;
+    start->fn = fn;
+    start->arg = arg;
+
+    if (pthread_create(&thread, NULL, taskStart, start) != 0)
+    {
+        free(start);
+        return pdFAIL;
+    }
+    pthread_setname_np(thread, name);
+    pthread_detach(thread);
+
+    if (task != NULL)
+        *task = NULL;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep(ticks * 1000);
+}
@@ -0,0 +1,26 @@
+/**
+ * @file FreeRTOS.h
+ * @brief host stand-in for the FreeRTOS types the tested modules use
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define portMAX_DELAY       0xffffffffu
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   (ms)
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file semphr.h
+ * @brief host semaphores over pthreads, a mutex is a binary semaphore given once
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef struct host_sem *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+
+/**
+ * @brief Take the semaphore
+ * @param s semaphore
+ * @param wait ticks, one per millisecond, or portMAX_DELAY
+ * @return pdTRUE or pdFALSE on timeout
+ */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait);
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s);
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file task.h
+ * @brief host tasks are threads, a tick is a millisecond
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct host_task *TaskHandle_t;
+
+/**
+ * @brief Start a detached thread named after the task, priority and stack are ignored
+ * @return pdPASS or pdFAIL
+ */
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, int priority, TaskHandle_t *task);
+
+/**
+ * @brief End the calling thread, only NULL is supported
+ */
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+
+#endif
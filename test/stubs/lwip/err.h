@@ -0,0 +1,9 @@
+/**
+ * @file err.h
+ * @brief host errno stands in for lwIP errors
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <errno.h>
@@ -0,0 +1,9 @@
+/**
+ * @file netdb.h
+ * @brief the host resolver stands in for lwIP
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <netdb.h>
@@ -0,0 +1,22 @@
+/**
+ * @file sockets.h
+ * @brief the host socket headers stand in for lwIP
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+// lwIP's port headers bring these in on the chip
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// lwIP takes the address of addr, so a struct in_addr or its s_addr both work
+#ifndef inet_ntoa_r
+#define inet_ntoa_r(addr, buf, buflen) inet_ntop(AF_INET, &(addr), (buf), (buflen))
+#endif
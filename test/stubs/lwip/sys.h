@@ -0,0 +1,7 @@
+/**
+ * @file sys.h
+ * @brief nothing from the lwIP system layer is used on the host
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
@@ -0,0 +1,162 @@
+/**
+ * @file udp_latency.c
+ * @brief round trip time and jitter through the UDP serial bridge
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ *
+ * udp_latency host port [count] [interval ms] [size]
+ *   sends numbered lines to the bridge and times the echo, which needs
+ *   the Propeller, or a loopback on the uart, to send each line back.
+ *   Lines end in '\n' to suit the default delimiter framing.
+ * udp_latency -e port
+ *   echoes datagrams itself, to try the tool without a module.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include "bench.h"
+
+#define LINE_MAX    1400
+#define TIMEOUT_MS  1000    // an echo later than this counts as lost
+
+
+static int echo(int port)
+{
+    struct sockaddr_in addr;
+    socklen_t len;
+    char buf[2048];
+    int sock, n;
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    while (true)
+    {
+        len = sizeof(addr);
+        n = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr*)&addr, &len);
+        if (n > 0)
+            sendto(sock, buf, n, 0, (struct sockaddr*)&addr, len);
+    }
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    struct addrinfo hints, *res;
+    struct timeval wait;
+    char line[LINE_MAX + 1], reply[2048];
+    double *rtt, sum, jitter, last;
+    int64_t sent;
+    int count, interval, size;
+    int sock, i, n, got, seq, late;
+
+    if ((argc == 3) && (strcmp(argv[1], "-e") == 0))
+        return echo(atoi(argv[2]));
+
+    if (argc < 3)
+    {
+        printf("usage: udp_latency host port [count] [interval ms] [size]\n       udp_latency -e port\n");
+        return 1;
+    }
+    count = argc > 3 ? atoi(argv[3]) : 1000;
+    interval = argc > 4 ? atoi(argv[4]) : 10;
+    size = argc > 5 ? atoi(argv[5]) : 32;
+    if (size < 12)
+        size = 12;
+    if (size > LINE_MAX)
+        size = LINE_MAX;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(argv[1], argv[2], &hints, &res) != 0)
+    {
+        printf("Unable to resolve %s\n", argv[1]);
+        return 1;
+    }
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    connect(sock, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+
+    wait.tv_sec = TIMEOUT_MS / 1000;
+    wait.tv_usec = TIMEOUT_MS % 1000 * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+
+    rtt = malloc(count * sizeof(double));
+    got = 0;
+    late = 0;
+    jitter = 0;
+    last = -1;
+    for (i = 0; i < count; i++)
+    {
+        // sequence number, padding, newline: nothing the parser would take as a command
+        n = sprintf(line, "%010d", i);
+        memset(&line[n], 'x', size - n - 1);
+        line[size - 1] = '\n';
+
+        sent = benchNow();
+        send(sock, line, size, 0);
+        while (true)
+        {
+            n = recv(sock, reply, sizeof(reply), 0);
+            if (n <= 0)
+                break;
+            seq = atoi(reply);
+            if (seq == i)
+                break;
+            late++;
+        }
+        if (n > 0)
+        {
+            rtt[got] = (benchNow() - sent) / 1e3;
+            // RFC 3550 interarrival jitter over consecutive round trips
+            if (last >= 0)
+                jitter += (fabs(rtt[got] - last) - jitter) / 16;
+            last = rtt[got];
+            got++;
+        }
+        if (interval > 0)
+            usleep(interval * 1000);
+    }
+
+    if (got == 0)
+    {
+        printf("no echoes in %d tries\n", count);
+        return 1;
+    }
+
+    sum = 0;
+    for (i = 0; i < got; i++)
+        sum += rtt[i];
+    qsort(rtt, got, sizeof(double), compare);
+    printf("%d of %d echoed, %d late\n", got, count, late);
+    printf("rtt us: min %.1f avg %.1f p50 %.1f p99 %.1f max %.1f\n", rtt[0], sum / got, rtt[got / 2],
+        rtt[(got - 1) * 99 / 100], rtt[got - 1]);
+    printf("jitter us: %.1f\n", jitter);
+
+    return 0;
+}
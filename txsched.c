@@ -0,0 +1,240 @@
+/**
+ * @file txsched.c
+ * @brief uart transmit scheduler
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "capture.h"
+#include "ring.h"
+#include "txsched.h"
+
+// bytes queued per class, a power of two, each message is its length then its data
+#define TX_RING 4096
+
+#define TX_FLUSH -1         // length that marks a flush request
+
+static const char *TAG = "txsched";
+
+static uart_port_t txPort;
+static char txData[TX_CLASSES][TX_RING];
+static ring_t txRings[TX_CLASSES];
+static atomic_uint txCount[TX_CLASSES];     // whole messages in each ring
+static SemaphoreHandle_t txLocks[TX_CLASSES];   // one producer per ring at a time
+static SemaphoreHandle_t txSpace[TX_CLASSES];   // given as the task frees room
+static SemaphoreHandle_t txWaiting;
+
+// one flush at a time waits for the task to reach its marker
+static SemaphoreHandle_t txFlushLock;
+static SemaphoreHandle_t txFlushed;
+
+static atomic_uint txHigh;
+static atomic_uint txMessages;
+static atomic_uint txBytes;
+static atomic_uint txStalls;
+static _Atomic uint64_t txStallTime;
+
+
+/**
+ * @brief copy a message into its class ring, waiting for room if it is full
+ * @param prio class
+ * @param len length of the message or TX_FLUSH
+ * @param iov pieces of the message
+ * @param count number of pieces
+ */
+static void txQueue(int prio, int len, const tx_iov *iov, int count)
+{
+    ring_t *r = &txRings[prio];
+    int64_t t;
+    unsigned depth, high;
+    int i, need;
+
+    need = sizeof(len) + (len > 0 ? len : 0);
+
+    xSemaphoreTake(txLocks[prio], portMAX_DELAY);
+    if (ringFree(r) < need)
+    {
+        atomic_fetch_add(&txStalls, 1);
+        t = esp_timer_get_time();
+        while (ringFree(r) < need)
+            xSemaphoreTake(txSpace[prio], portMAX_DELAY);
+        atomic_fetch_add(&txStallTime, esp_timer_get_time() - t);
+    }
+
+    ringWrite(r, (const char*)&len, sizeof(len));
+    for (i = 0; i < count; i++)
+        ringWrite(r, iov[i].base, iov[i].len);
+
+    // the task only looks at whole messages
+    atomic_fetch_add(&txCount[prio], 1);
+    xSemaphoreGive(txLocks[prio]);
+
+    depth = atomic_load(&txCount[TX_RESPONSE]) + atomic_load(&txCount[TX_BULK]);
+    high = atomic_load(&txHigh);
+    while ((depth > high) && !atomic_compare_exchange_weak(&txHigh, &high, depth))
+        ;
+
+    xSemaphoreGive(txWaiting);
+}
+
+/**
+ * @brief take the length at the front of a ring
+ * @param r ring
+ * @return message length or TX_FLUSH
+ */
+static int txLength(ring_t *r)
+{
+    char *p;
+    int len, t, n;
+
+    for (t = 0; t < sizeof(len); t += n)
+    {
+        n = ringPeek(r, &p);
+        if (n > sizeof(len) - t)
+            n = sizeof(len) - t;
+        memcpy((char*)&len + t, p, n);
+        ringConsume(r, n);
+    }
+
+    return len;
+}
+
+/**
+ * @brief write message data to the uart straight from the ring
+ * @param r ring
+ * @param len length of the message
+ */
+static void txWrite(ring_t *r, int len)
+{
+    char *p;
+    int n;
+
+    while (len > 0)
+    {
+        n = ringPeek(r, &p);
+        if (n > len)
+            n = len;
+        uart_write_bytes(txPort, p, n);
+        captureWrite(CAPTURE_TX, p, n);
+        ringConsume(r, n);
+        len -= n;
+    }
+}
+
+/**
+ * @brief write queued messages, responses before bulk data
+ */
+static void txTask(void *parms)
+{
+    int i, len;
+
+    while (true)
+    {
+        xSemaphoreTake(txWaiting, portMAX_DELAY);
+
+        // every give matches one queued message
+        for (i = 0; i < TX_CLASSES; i++)
+        {
+            if (atomic_load(&txCount[i]) > 0)
+                break;
+        }
+        if (i == TX_CLASSES)
+            continue;
+
+        len = txLength(&txRings[i]);
+        if (len == TX_FLUSH)
+        {
+            atomic_fetch_sub(&txCount[i], 1);
+            uart_wait_tx_done(txPort, portMAX_DELAY);
+            xSemaphoreGive(txFlushed);
+            xSemaphoreGive(txSpace[i]);
+            continue;
+        }
+
+        // only this task writes the uart, so the pieces of a wrapped message stay together
+        txWrite(&txRings[i], len);
+        atomic_fetch_sub(&txCount[i], 1);
+        xSemaphoreGive(txSpace[i]);
+        atomic_fetch_add(&txMessages, 1);
+        atomic_fetch_add(&txBytes, len);
+    }
+}
+
+void txInit(uart_port_t port)
+{
+    int i;
+
+    txPort = port;
+    for (i = 0; i < TX_CLASSES; i++)
+    {
+        txRings[i].buf = txData[i];
+        txRings[i].size = TX_RING;
+        txLocks[i] = xSemaphoreCreateMutex();
+        txSpace[i] = xSemaphoreCreateBinary();
+    }
+    txWaiting = xSemaphoreCreateCounting(TX_RING * TX_CLASSES, 0);
+    txFlushLock = xSemaphoreCreateMutex();
+    txFlushed = xSemaphoreCreateBinary();
+
+    xTaskCreate(txTask, "uarttx", 2048, NULL, 6, NULL);
+}
+
+int txSubmit(int prio, const tx_iov *iov, int count)
+{
+    int i, len;
+
+    if (txWaiting == NULL)
+        return -1;
+
+    len = 0;
+    for (i = 0; i < count; i++)
+        len += iov[i].len;
+    if (len <= 0)
+        return 0;
+
+    if (sizeof(len) + len > TX_RING)
+    {
+        ESP_LOGE(TAG, "Message of %d bytes is larger than the queue", len);
+        return -1;
+    }
+
+    txQueue(prio, len, iov, count);
+    return len;
+}
+
+int txSend(int prio, const void *data, int len)
+{
+    tx_iov iov = { data, len };
+
+    return txSubmit(prio, &iov, 1);
+}
+
+void txFlush(void)
+{
+    if (txWaiting == NULL)
+        return;
+
+    // bulk goes last so everything queued before has been written
+    xSemaphoreTake(txFlushLock, portMAX_DELAY);
+    txQueue(TX_BULK, TX_FLUSH, NULL, 0);
+    xSemaphoreTake(txFlushed, portMAX_DELAY);
+    xSemaphoreGive(txFlushLock);
+}
+
+void txGetStats(tx_stats *stats)
+{
+    stats->depth = atomic_load(&txCount[TX_RESPONSE]) + atomic_load(&txCount[TX_BULK]);
+    stats->high = atomic_load(&txHigh);
+    stats->messages = atomic_load(&txMessages);
+    stats->bytes = atomic_load(&txBytes);
+    stats->stalls = atomic_load(&txStalls);
+    stats->stallTime = atomic_load(&txStallTime);
+}
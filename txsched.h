@@ -0,0 +1,71 @@
+/**
+ * @file txsched.h
+ * @brief uart transmit scheduler
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef TXSCHED_H
+#define TXSCHED_H
+
+#include <stdint.h>
+#include "driver/uart.h"
+
+// priority classes, lower goes first
+#define TX_RESPONSE 0
+#define TX_BULK     1
+#define TX_CLASSES  2
+
+typedef struct
+{
+    const void *base;
+    int len;
+} tx_iov;
+
+typedef struct
+{
+    uint32_t depth;         // messages waiting now
+    uint32_t high;          // most messages ever waiting
+    uint32_t messages;      // messages written
+    uint32_t bytes;         // bytes written
+    uint32_t stalls;        // submits that waited for queue space
+    uint64_t stallTime;     // total time spent waiting in microseconds
+} tx_stats;
+
+/**
+ * @brief Start the transmit task for a uart
+ * @param port installed uart driver
+ */
+void txInit(uart_port_t port);
+
+/**
+ * @brief Queue pieces of data to go out as one contiguous write
+ * @param prio TX_RESPONSE or TX_BULK
+ * @param iov pieces in order
+ * @param count number of pieces
+ * @return bytes queued or -1 if larger than the queue
+ */
+int txSubmit(int prio, const tx_iov *iov, int count);
+
+/**
+ * @brief Queue a single buffer
+ * @param prio TX_RESPONSE or TX_BULK
+ * @param data to write
+ * @param len length of data
+ * @return bytes queued or -1 if larger than the queue
+ */
+int txSend(int prio, const void *data, int len);
+
+/**
+ * @brief Wait until everything queued so far has left the uart
+ */
+void txFlush(void);
+
+/**
+ * @brief Snapshot of the transmit counters
+ * @param stats filled in
+ */
+void txGetStats(tx_stats *stats);
+
+#endif
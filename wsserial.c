@@ -0,0 +1,331 @@
+/**
+ * @file wsserial.c
+ * @brief websocket serial console
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "ring.h"
+#include "parser.h"
+#include "wsserial.h"
+
+static const char *TAG = "wsserial";
+
+typedef struct
+{
+    int fd;
+    ring_t queue;       // uart output waiting for the socket
+    bool busy;          // a flush is queued on the server task
+} ws_sub;
+
+// the lock covers the subscriber table and the queue contents
+static ws_sub Subs[WS_MAX];
+static SemaphoreHandle_t wsLock;
+static httpd_handle_t wsServer;
+static uint32_t wsDropped;
+static uint32_t wsInputDropped;
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+// only the server task builds frames
+static char wsFrame[WS_FRAME];
+
+/**
+ * @brief forget a subscriber, called with the lock held
+ * @param i subscriber
+ */
+static void wsDrop(int i)
+{
+    free(Subs[i].queue.buf);
+    Subs[i].queue.buf = NULL;
+    Subs[i].fd = -1;
+    Subs[i].busy = false;
+}
+
+static void wsAdd(int fd)
+{
+    int i, slot;
+
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+
+    // reuse slots of sessions the server has already closed
+    slot = -1;
+    for (i = 0; i < WS_MAX; i++)
+    {
+        if ((Subs[i].fd >= 0) && (httpd_ws_get_fd_info(wsServer, Subs[i].fd) != HTTPD_WS_CLIENT_WEBSOCKET))
+            wsDrop(i);
+        if ((Subs[i].fd < 0) && (slot < 0))
+            slot = i;
+    }
+
+    if (slot >= 0)
+    {
+        Subs[slot].queue.buf = malloc(WS_QUEUE);
+        if (Subs[slot].queue.buf != NULL)
+        {
+            Subs[slot].queue.size = WS_QUEUE;
+            Subs[slot].queue.ready = NULL;
+            Subs[slot].queue.high = 0;
+            atomic_store(&Subs[slot].queue.head, 0);
+            atomic_store(&Subs[slot].queue.tail, 0);
+            Subs[slot].queue.space = NULL;
+            atomic_store(&Subs[slot].queue.full, false);
+            Subs[slot].fd = fd;
+        }
+        else
+        {
+            slot = -1;
+        }
+    }
+
+    xSemaphoreGive(wsLock);
+
+    if (slot < 0)
+        ESP_LOGW(TAG, "No room for subscriber %d", fd);
+    else
+        ESP_LOGI(TAG, "Subscriber %d", fd);
+}
+
+/**
+ * @brief send one binary frame from a subscriber's queue, runs on the server task
+ * @param arg subscriber index
+ *
+ * Work for the rest of the queue goes to the back of the server's work
+ * queue so requests and other subscribers get a turn between frames.
+ */
+static void wsFlush(void *arg)
+{
+    int i = (int)(intptr_t)arg;
+    httpd_ws_frame_t frame;
+    char *data;
+    int fd, len, n;
+    bool more;
+
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    fd = Subs[i].fd;
+    len = 0;
+    if (fd >= 0)
+    {
+        while ((len < WS_FRAME) && ((n = ringPeek(&Subs[i].queue, &data)) > 0))
+        {
+            if (n > WS_FRAME - len)
+                n = WS_FRAME - len;
+            memcpy(&wsFrame[len], data, n);
+            ringConsume(&Subs[i].queue, n);
+            len += n;
+        }
+    }
+    if (len == 0)
+    {
+        Subs[i].busy = false;
+        xSemaphoreGive(wsLock);
+        return;
+    }
+    xSemaphoreGive(wsLock);
+
+    memset(&frame, 0, sizeof(frame));
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.payload = (uint8_t*)wsFrame;
+    frame.len = len;
+    if (httpd_ws_send_frame_async(wsServer, fd, &frame) != ESP_OK)
+    {
+        ESP_LOGI(TAG, "Subscriber %d gone", fd);
+        xSemaphoreTake(wsLock, portMAX_DELAY);
+        if (Subs[i].fd == fd)
+            wsDrop(i);
+        xSemaphoreGive(wsLock);
+        httpd_sess_trigger_close(wsServer, fd);
+        return;
+    }
+
+    // busy stays set while more work is queued
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    more = (Subs[i].fd == fd) && (ringUsed(&Subs[i].queue) > 0);
+    if (!more)
+        Subs[i].busy = false;
+    xSemaphoreGive(wsLock);
+
+    if (more && (httpd_queue_work(wsServer, wsFlush, arg) != ESP_OK))
+    {
+        xSemaphoreTake(wsLock, portMAX_DELAY);
+        Subs[i].busy = false;
+        xSemaphoreGive(wsLock);
+    }
+}
+
+void wsSerialSend(char *data, int len)
+{
+    bool flush[WS_MAX];
+    ring_t *q;
+    int i, n, room;
+
+    if ((wsLock == NULL) || (len <= 0))
+        return;
+
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (i = 0; i < WS_MAX; i++)
+    {
+        flush[i] = false;
+        if (Subs[i].fd < 0)
+            continue;
+
+        // a slow tab loses its oldest output rather than holding the uart
+        q = &Subs[i].queue;
+        room = ringFree(q);
+        if (room < len)
+        {
+            n = len - room;
+            if (n > ringUsed(q))
+                n = ringUsed(q);
+            ringConsume(q, n);
+            wsDropped += n;
+        }
+        if (len > q->size)
+        {
+            wsDropped += len - q->size;
+            ringWrite(q, &data[len - q->size], q->size);
+        }
+        else
+        {
+            ringWrite(q, data, len);
+        }
+
+        if (!Subs[i].busy)
+        {
+            Subs[i].busy = true;
+            flush[i] = true;
+        }
+    }
+    xSemaphoreGive(wsLock);
+
+    for (i = 0; i < WS_MAX; i++)
+    {
+        if (flush[i] && (httpd_queue_work(wsServer, wsFlush, (void*)(intptr_t)i) != ESP_OK))
+        {
+            xSemaphoreTake(wsLock, portMAX_DELAY);
+            Subs[i].busy = false;
+            xSemaphoreGive(wsLock);
+        }
+    }
+}
+
+esp_err_t wsSerialHandler(httpd_req_t *req)
+{
+    httpd_ws_frame_t frame;
+    ring_t *ring;
+    uint8_t *buf;
+    esp_err_t err;
+
+    // the handshake subscribes the session
+    if (req->method == HTTP_GET)
+    {
+        wsAdd(httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK)
+        return err;
+    if ((frame.len == 0) || ((frame.type != HTTPD_WS_TYPE_BINARY) && (frame.type != HTTPD_WS_TYPE_TEXT)))
+        return ESP_OK;
+    if (frame.len > WS_QUEUE)
+        return ESP_ERR_INVALID_SIZE;
+
+    buf = malloc(frame.len);
+    if (buf == NULL)
+        return ESP_ERR_NO_MEM;
+    frame.payload = buf;
+    err = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (err == ESP_OK)
+    {
+        // input goes to the uart through the parser like telnet data,
+        // a frame that does not fit is dropped whole rather than waited for
+        ring = receiveRing(RECEIVE_WS);
+        if (ringFree(ring) >= frame.len)
+        {
+            ringWrite(ring, (char*)buf, frame.len);
+        }
+        else
+        {
+            ring->stalls++;
+            wsInputDropped += frame.len;
+        }
+    }
+    free(buf);
+
+    return err;
+}
+
+void wsSerialClose(int fd)
+{
+    int i;
+
+    if (wsLock == NULL)
+        return;
+
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (i = 0; i < WS_MAX; i++)
+    {
+        if (Subs[i].fd == fd)
+        {
+            wsDrop(i);
+            ESP_LOGI(TAG, "Subscriber %d closed", fd);
+        }
+    }
+    xSemaphoreGive(wsLock);
+}
+
+#else
+
+void wsSerialSend(char *data, int len)
+{
+}
+
+void wsSerialClose(int fd)
+{
+}
+
+#endif
+
+void wsSerialInit(httpd_handle_t server)
+{
+    int i;
+
+    if (wsLock == NULL)
+    {
+        wsLock = xSemaphoreCreateMutex();
+        for (i = 0; i < WS_MAX; i++)
+            Subs[i].fd = -1;
+    }
+
+    // sessions do not survive a server restart
+    xSemaphoreTake(wsLock, portMAX_DELAY);
+    for (i = 0; i < WS_MAX; i++)
+    {
+        free(Subs[i].queue.buf);
+        Subs[i].queue.buf = NULL;
+        Subs[i].fd = -1;
+        Subs[i].busy = false;
+    }
+    wsServer = server;
+    xSemaphoreGive(wsLock);
+}
+
+uint32_t wsSerialDropped(void)
+{
+    return wsDropped;
+}
+
+uint32_t wsSerialInputDropped(void)
+{
+    return wsInputDropped;
+}
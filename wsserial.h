@@ -0,0 +1,57 @@
+/**
+ * @file wsserial.h
+ * @brief websocket serial console
+ * @author agent
+ * @date October 17, 2026
+ * @version 1.0
+ */
+
+#ifndef WSSERIAL_H
+#define WSSERIAL_H
+
+#include "esp_http_server.h"
+
+// subscribers and the output each may have queued
+#define WS_MAX 4
+#define WS_QUEUE 4096
+#define WS_FRAME 1024
+
+/**
+ * @brief Attach the console to a started server
+ * @param server http server, subscribers of an earlier server are dropped
+ */
+void wsSerialInit(httpd_handle_t server);
+
+/**
+ * @brief Queue uart output to every subscriber without blocking
+ * @param data output
+ * @param len length of output
+ */
+void wsSerialSend(char *data, int len);
+
+/**
+ * @brief /ws/serial handler, binary frames out, text or binary frames in
+ * @param req request
+ * @return esp error value
+ */
+esp_err_t wsSerialHandler(httpd_req_t *req);
+
+/**
+ * @brief Forget a session the server is closing, before its fd can be reused
+ * @param fd socket of the session
+ */
+void wsSerialClose(int fd);
+
+/**
+ * @brief Bytes dropped from slow subscribers' queues
+ * @return count
+ */
+uint32_t wsSerialDropped(void);
+
+/**
+ * @brief Input bytes dropped because the uart side was full
+ * @return count
+ */
+uint32_t wsSerialInputDropped(void);
+
+#endif